@@ -1,4 +1,11 @@
 #include "ConvexPolygon.h"
+#include "SvgWriter.h"
+
+#include <cstdio>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
 
 
 using namespace std;
@@ -15,29 +22,140 @@ static double cross_p(const Point& a, const Point& b, const Point& c) {
 	return (b.X() - a.X()) * (c.Y() - a.Y()) - (b.Y() - a.Y()) * (c.X() - a.X());
 }
 
-/**	Compares two points using the x-coordinate first
+/**	Returns the largest absolute value of the coordinates of a point. */
+static double magnitude(const Point& p) {
+	return max(abs(p.X()), abs(p.Y()));
+}
+
+/**	Tells whether abc does not make a clockwise turn, so c is on the left of ab or on its line.
+ *	The rounding errors of the cross product grow with the sides ab and ac and with the
+ *	coordinates, and so does the tolerance: c is on the line if it is at most about 1e-12
+ *	times the size of the points away from it, whatever their scale.
+ */
+static bool not_clockwise(const Point& a, const Point& b, const Point& c) {
+	double ux = b.X() - a.X(), uy = b.Y() - a.Y(), wx = c.X() - a.X(), wy = c.Y() - a.Y();
+	double u = abs(ux) + abs(uy), w = abs(wx) + abs(wy);
+	double m = max(magnitude(a), max(magnitude(b), magnitude(c)));
+	return ux*wy - uy*wx >= -1e-12*(u*w + m*(u + w));
+}
+
+/**	Compares two points using the x-coordinate first. The difference is compared, as
+ *	adding the tolerance to a large coordinate would not change it.
  */
 static bool compare(const Point& p, const Point& q) {
-    if (p.X() < q.X() + 1e-12 and p.X() > q.X() - 1e-12) return p.Y() < q.Y();
+    if (abs(p.X() - q.X()) < 1e-12) return p.Y() < q.Y();
     else return p.X() < q.X();
 }
 
+/** Minimum number of points for which the interior points are discarded
+ *	before sorting them in convex_hull. For fewer points, sorting them all
+ *	is faster than checking them.
+ */
+static const int PREFILTER_MIN_POINTS = 64;
+
+/** Removes points that cannot be vertices of the convex hull (Akl-Toussaint
+ *	heuristic). The extreme points in eight directions (x, y, x+y and x-y)
+ *	describe an octagon inside the hull, so the points strictly inside it
+ *	are discarded. The margin keeps every point that the tolerance of
+ *	convex_hull could treat as being on the boundary. It grows with the
+ *	square of the coordinates, as the rounding errors of the cross products
+ *	do, so it neither discards hull points of large polygons nor keeps all
+ *	the points of small ones. Complexity: O(n).
+ */
+static void discard_interior_points(vector<Point>& points) {
+	// Extreme points, in counter-clockwise order starting at the bottom
+	vector<Point> oct(8, points[0]);
+	for (const Point& p : points) {
+		double x = p.X(), y = p.Y();
+		if (y < oct[0].Y()) oct[0] = p;
+		if (x - y > oct[1].X() - oct[1].Y()) oct[1] = p;
+		if (x > oct[2].X()) oct[2] = p;
+		if (x + y > oct[3].X() + oct[3].Y()) oct[3] = p;
+		if (y > oct[4].Y()) oct[4] = p;
+		if (x - y < oct[5].X() - oct[5].Y()) oct[5] = p;
+		if (x < oct[6].X()) oct[6] = p;
+		if (x + y < oct[7].X() + oct[7].Y()) oct[7] = p;
+	}
+
+	vector<Point> octagon;
+	for (const Point& p : oct) {
+		if (octagon.empty() or p != octagon.back()) octagon.push_back(p);
+	}
+	while (octagon.size() > 1 and octagon.back() == octagon.front()) octagon.pop_back();
+	int m = octagon.size();
+	if (m < 3) return;
+
+	// Points inside the octagon have no larger coordinates than its vertices.
+	double scale = 0;
+	for (const Point& p : octagon) scale = max(scale, max(abs(p.X()), abs(p.Y())));
+	double margin = 4e-12*scale*scale;
+
+	int kept = 0;
+	for (const Point& p : points) {
+		bool inside = true;
+		for (int i=0; i<m and inside; ++i) {
+			inside = cross_p(octagon[i], octagon[(i+1)%m], p) > margin;
+		}
+		if (not inside) points[kept++] = p;
+	}
+	points.resize(kept);
+}
+
+/** Number of previous points that merge_close_points compares each point with. */
+static const int MERGE_WINDOW = 8;
+
+/** Merges the points that are closer than a trillionth of the largest coordinate. Computed
+ *	intersections give several copies of the same vertex that differ by rounding errors, and
+ *	the hull would keep them as tiny edges, or even in the wrong order. The tolerance scales
+ *	with the coordinates, so small polygons keep all their vertices. The points must be
+ *	sorted by compare, so the copies of a vertex are close to each other and each point is
+ *	only compared with the few points kept before it: O(n) complexity.
+ */
+static void merge_close_points (vector<Point>& points) {
+	double scale = 0;
+	for (const Point& p : points) scale = max(scale, max(abs(p.X()), abs(p.Y())));
+	double tolerance = 1e-12*scale;
+	int kept = 0;
+	for (const Point& p : points) {
+		bool close = false;
+		for (int i=kept-1; i>=0 and i>=kept-MERGE_WINDOW and points[i].X() >= p.X() - tolerance and not close; --i) {
+			close = abs(points[i].Y() - p.Y()) <= tolerance;
+		}
+		if (not close) points[kept++] = p;
+	}
+	points.resize(kept);
+}
+
 /** Returns the convex hull as a list of points in counter-clockwise order
  *	The convex hull of the points given is computed using 
- *	Andrew's monotone chain algorithm (n log n complexity)
+ *	Andrew's monotone chain algorithm (n log n complexity). Large inputs are
+ *	first reduced to the points that can be vertices of the hull, so the
+ *	sort only sees few of them when most of the points are interior.
  */
 vector<Point> ConvexPolygon::convex_hull(vector<Point>& points) {
+	if (int(points.size()) >= PREFILTER_MIN_POINTS) discard_interior_points(points);
 	sort(points.begin(), points.end(), compare);
+	merge_close_points(points);
 	int n = points.size();
 
 	// If the polygon has 2 or fewer points, points is already the desired output.
 	if (n <= 2) return points;
 
+	// Turns smaller than this are taken as collinear. Cross products grow with the square
+	// of the size of the points, so the tolerance does too and small polygons keep their vertices.
+	double x_min = INFINITY, x_max = -INFINITY, y_min = INFINITY, y_max = -INFINITY;
+	for (const Point& p : points) {
+		x_min = min(x_min, p.X()); x_max = max(x_max, p.X());
+		y_min = min(y_min, p.Y()); y_max = max(y_max, p.Y());
+	}
+	double size = max(x_max - x_min, y_max - y_min);
+	double collinear = 1e-12*size*size;
+
 	// Lower hull
 	vector<Point> conv_hull(0);
 	int hn = 0;	// The size of the hull
 	for (int i=0; i<n; ++i) {
-		while (hn >= 2 and cross_p(conv_hull[hn-2], conv_hull[hn-1], points[i]) <= 0) {
+		while (hn >= 2 and cross_p(conv_hull[hn-2], conv_hull[hn-1], points[i]) <= collinear) {
 			conv_hull.pop_back(); --hn;
 		}
 		conv_hull.push_back(points[i]);
@@ -48,7 +166,7 @@ vector<Point> ConvexPolygon::convex_hull(vector<Point>& points) {
 
 	// Upper hull
 	for (int i=n-2; i>=0; --i) {
-		while (hn > lohusize and cross_p(conv_hull[hn-2], conv_hull[hn-1], points[i]) <= 0) {
+		while (hn > lohusize and cross_p(conv_hull[hn-2], conv_hull[hn-1], points[i]) <= collinear) {
 			conv_hull.pop_back(); --hn;
 		}
 		conv_hull.push_back(points[i]);
@@ -61,86 +179,289 @@ vector<Point> ConvexPolygon::convex_hull(vector<Point>& points) {
 }
 
 /** Void constructor */
-ConvexPolygon::ConvexPolygon() {}
+ConvexPolygon::ConvexPolygon()
+:	n_vertices(0)
+{	}
 
 /** Constructor */
 ConvexPolygon::ConvexPolygon(vector<Point>& points) {
-	theVertices = convex_hull(points);
+	set_vertices(convex_hull(points));
 }
 
 /** Constructor */
 ConvexPolygon::ConvexPolygon(vector<Point>& points, bool points_sorted) {
-	if (not points_sorted) theVertices = convex_hull(points);
-	else theVertices = points;
+	if (not points_sorted) set_vertices(convex_hull(points));
+	else set_vertices(points);
+}
+
+/** Replaces the vertices of the polygon. The previous ones are not modified,
+ *  as other copies of the polygon may still be using them.
+ */
+void ConvexPolygon::set_vertices (vector<Point> points) {
+	if (points.size() <= CONVEX_POLYGON_INLINE_VERTICES) set_vertices(points.data(), points.size());
+	else {
+		n_vertices = points.size();
+		theVertices = make_shared<const vector<Point>>(move(points));
+	}
+}
+
+/** Replaces the vertices of the polygon with the n points starting at first, which
+ *  may be the current vertices. Few vertices are stored in the polygon itself.
+ */
+void ConvexPolygon::set_vertices (const Point* first, int n) {
+	if (n <= CONVEX_POLYGON_INLINE_VERTICES) {
+		copy(first, first + n, inline_vertices);
+		theVertices.reset();
+	}
+	else theVertices = make_shared<const vector<Point>>(first, first + n);
+	n_vertices = n;
+}
+
+/** Takes the vertices of another polygon, sharing its buffer if it has one. */
+void ConvexPolygon::share_vertices (const ConvexPolygon& cpol) {
+	n_vertices = cpol.n_vertices;
+	copy(cpol.inline_vertices, cpol.inline_vertices + CONVEX_POLYGON_INLINE_VERTICES, inline_vertices);
+	theVertices = cpol.theVertices;
 }
 
 /** Returns the vertices of the polygon in counter-clockwise order. */
-vector<Point> ConvexPolygon::vertices () const {
-	return theVertices;
+ConvexPolygon::Vertices ConvexPolygon::vertices () const & {
+	if (n_vertices <= CONVEX_POLYGON_INLINE_VERTICES) return Vertices(inline_vertices, n_vertices);
+	return Vertices(theVertices->data(), n_vertices);
+}
+
+/** Returns a copy of the vertices of a temporary polygon. */
+vector<Point> ConvexPolygon::vertices () const && {
+	return vertices();
+}
+
+/** Tells whether the polygon is a rectangle with horizontal and vertical sides.
+ *  The convex hull starts at the lower left corner, so the first side is horizontal.
+ */
+bool ConvexPolygon::is_axis_rectangle () const {
+	if (n_vertices != 4) return false;
+	Vertices v = vertices();
+	return v[0].Y() == v[1].Y() and v[1].X() == v[2].X() and v[2].Y() == v[3].Y() and v[3].X() == v[0].X();
+}
+
+
+/** Composes an affine transform with the one of the polygon: the new transform moves
+ *  each point as the previous one and then as (a*x + b*y + c, d*x + e*y + f).
+ *  The vertices are not changed, so it takes constant time.
+ */
+ConvexPolygon& ConvexPolygon::transform (double a, double b, double c, double d, double e, double f) {
+	const double t[6] = {
+		a*affine[0] + b*affine[3], a*affine[1] + b*affine[4], a*affine[2] + b*affine[5] + c,
+		d*affine[0] + e*affine[3], d*affine[1] + e*affine[4], d*affine[2] + e*affine[5] + f
+	};
+	copy(t, t + 6, affine);
+	return *this;
+}
+
+/** Moves the polygon by (dx, dy). */
+ConvexPolygon& ConvexPolygon::translate (double dx, double dy) {
+	return transform(1, 0, dx, 0, 1, dy);
+}
+
+/** Scales the polygon from the origin. */
+ConvexPolygon& ConvexPolygon::scale (double sx, double sy) {
+	return transform(sx, 0, 0, 0, sy, 0);
+}
+
+/** Rotates the polygon counter-clockwise around the origin (angle in degrees). */
+ConvexPolygon& ConvexPolygon::rotate (double degrees) {
+	double angle = degrees*M_PI/180;
+	double c = cos(angle), s = sin(angle);
+
+	// Right angles are exact, so that the vertices stay where they should.
+	double quarters = degrees/90;
+	if (quarters == floor(quarters)) {
+		int q = int(fmod(quarters, 4) + 4)%4;
+		c = q == 0 ? 1 : q == 2 ? -1 : 0;
+		s = q == 1 ? 1 : q == 3 ? -1 : 0;
+	}
+	return transform(c, -s, 0, s, c, 0);
+}
+
+/** Tells whether the polygon has a transform that has not been applied to its vertices. */
+bool ConvexPolygon::transformed () const {
+	return affine[0] != 1 or affine[1] != 0 or affine[2] != 0 or affine[3] != 0 or affine[4] != 1 or affine[5] != 0;
+}
+
+/** Applies the transform to a point. */
+Point ConvexPolygon::apply (const Point& p) const {
+	return Point(affine[0]*p.X() + affine[1]*p.Y() + affine[2], affine[3]*p.X() + affine[4]*p.Y() + affine[5]);
+}
+
+/** Applies the inverse of the transform to a point. */
+Point ConvexPolygon::unapply (const Point& p) const {
+	double det = determinant();
+	double x = p.X() - affine[2], y = p.Y() - affine[5];
+	return Point((affine[4]*x - affine[1]*y)/det, (affine[0]*y - affine[3]*x)/det);
+}
+
+/** Returns the determinant of the linear part of the transform. */
+double ConvexPolygon::determinant () const {
+	return affine[0]*affine[4] - affine[1]*affine[3];
+}
+
+/** Tells whether the transform can be undone: its determinant is neither zero, nor so
+ *  small or large that it is not a normal number.
+ */
+bool ConvexPolygon::invertible () const {
+	return isnormal(determinant());
 }
 
-/** Removes last vertex of the vector of vertices. */
-void ConvexPolygon::remove_last_vertex() {
-	theVertices.pop_back();
+/** Tells whether the transform is a combination of moves, rotations, reflections and
+ *  scalings by the same factor in all directions, so that all distances are multiplied
+ *  by the same factor. Composed rotations differ by rounding errors, so the coefficients
+ *  are compared with a tolerance relative to their size.
+ */
+bool ConvexPolygon::similarity (double& factor) const {
+	factor = sqrt(affine[0]*affine[0] + affine[3]*affine[3]);
+	double tolerance = 1e-12*(abs(affine[0]) + abs(affine[1]) + abs(affine[3]) + abs(affine[4]));
+	bool rotation = abs(affine[0] - affine[4]) <= tolerance and abs(affine[1] + affine[3]) <= tolerance;
+	bool reflection = abs(affine[0] + affine[4]) <= tolerance and abs(affine[1] - affine[3]) <= tolerance;
+	return rotation or reflection;
 }
 
+/** Removes the transform without applying it. */
+void ConvexPolygon::clear_transform () {
+	affine[0] = affine[4] = 1;
+	affine[1] = affine[2] = affine[3] = affine[5] = 0;
+}
+
+/** Applies the transform of the polygon to its vertices. Transforms that reverse the
+ *  orientation also reverse the order of the vertices, which then start at the same
+ *  vertex as the convex hull of the moved points would. O(n) complexity.
+ */
+ConvexPolygon& ConvexPolygon::materialize () {
+	if (not transformed()) return *this;
+	vector<Point> points;
+	points.reserve(n_vertices);
+	for (const Point& p : vertices()) points.push_back(apply(p));
+	double det = determinant();
+	clear_transform();
+	if (det == 0) {
+		set_vertices(convex_hull(points));
+		return *this;
+	}
+	if (det < 0) reverse(points.begin(), points.end());
+	std::rotate(points.begin(), min_element(points.begin(), points.end(), compare), points.end());
+	set_vertices(move(points));
+	return *this;
+}
+
+/** Returns a copy of the polygon with its transform applied. */
+ConvexPolygon ConvexPolygon::applied () const {
+	ConvexPolygon cpol = *this;
+	return cpol.materialize();
+}
+
+/** Returns a copy of the polygon without its transform. */
+ConvexPolygon ConvexPolygon::untransformed () const {
+	ConvexPolygon cpol = *this;
+	cpol.clear_transform();
+	return cpol;
+}
 
 /** Returns the perimeter of the polygon. 
  *  It does so by adding the distance between each two adjacent vertices.
  */
 double ConvexPolygon::perimeter () const {
+	double factor;
+	if (transformed()) return similarity(factor) ? factor*untransformed().perimeter() : applied().perimeter();
 	double perim = 0;
-	int n = theVertices.size();
+	int n = vertices().size();
+	if (n == 0) return 0;
 	for (int i=0; i<n-1; ++i) {
-		perim += theVertices[i].distance(theVertices[i+1]);
+		perim += vertices()[i].distance(vertices()[i+1]);
 	}
-	perim += theVertices[n-1].distance(theVertices[0]); // The distance between the first and last vertices
+	perim += vertices()[n-1].distance(vertices()[0]); // The distance between the first and last vertices
 	return perim;
 }
 
 /* Returns the area of the polygon.
- * Substract and conquer approach. O(n) complexity.
- * Calculates the area of the triangles using Heron's formula.
+ * It is computed with the shoelace formula of metrics. O(n) complexity.
+ * Rectangles with horizontal and vertical sides are computed directly.
  */
 double ConvexPolygon::area () const {
-	int n = theVertices.size();
-	if (n < 3) return 0;
-	if (n == 3) {
-		double a = theVertices[0].distance(theVertices[1]);	// Lengths of
-		double b = theVertices[1].distance(theVertices[2]);	// the sides of
-		double c = theVertices[2].distance(theVertices[0]);	// the triangle
-		double s = 0.5*perimeter();
-		return sqrt(s*(s-a)*(s-b)*(s-c));
-	}
-	vector<Point> aux_vec = {theVertices[n-2], theVertices[n-1], theVertices[0]};
-	ConvexPolygon polyg_copy = *this;
-	polyg_copy.remove_last_vertex();
-	return (ConvexPolygon(aux_vec).area() + ConvexPolygon(polyg_copy).area());
-}
-
-/** Returns the centroid of the polygon. */
+	if (transformed()) return abs(determinant())*untransformed().area();
+	Vertices v = vertices();
+	if (is_axis_rectangle()) return (v[2].X() - v[0].X())*(v[2].Y() - v[0].Y());
+	double a, perim;
+	Point c;
+	metrics(a, perim, c);
+	return a;
+}
+
+/** Returns the centroid of the polygon. An empty polygon (such as an empty intersection)
+ *  has no centroid, so the origin is returned, as its area and perimeter are 0.
+ */
 Point ConvexPolygon::centroid () const {
+	int n = vertices().size();
+	if (n == 0) return Point(0, 0);
 	double sum_x = 0, sum_y = 0;
-	for (const Point& p : theVertices) {
+	for (const Point& p : vertices()) {
 		sum_x += p.X(); sum_y += p.Y();
 	}
-	int n = theVertices.size();
 	sum_x /= n; sum_y /= n;
+	if (transformed()) return apply(Point(sum_x, sum_y));
 	return Point(sum_x, sum_y);
 }
 
+/** Computes the area, the perimeter and the centroid (the same as centroid())
+ *	of the polygon with a single pass over its vertices. The area is computed
+ *	with the shoelace formula. O(n) complexity.
+ */
+void ConvexPolygon::metrics (double& area, double& perimeter, Point& centroid) const {
+	if (vertices().empty()) {
+		area = perimeter = 0;
+		centroid = Point(0, 0);
+		return;
+	}
+	if (transformed()) {
+		untransformed().metrics(area, perimeter, centroid);
+		double factor;
+		area *= abs(determinant());
+		perimeter = similarity(factor) ? factor*perimeter : this->perimeter();
+		centroid = apply(centroid);
+		return;
+	}
+	Vertices v = vertices();
+	int n = v.size();
+	double twice_area = 0, perim = 0, sum_x = 0, sum_y = 0;
+	for (int i=0; i<n; ++i) {
+		const Point& p = v[i];
+		const Point& q = v[i+1 < n ? i+1 : 0];
+		twice_area += p.X()*q.Y() - q.X()*p.Y();
+		perim += p.distance(q);
+		sum_x += p.X(); sum_y += p.Y();
+	}
+	area = n < 3 ? 0 : 0.5*twice_area;
+	perimeter = perim;
+	centroid = Point(sum_x/n, sum_y/n);
+}
+
 /** Sets the color of the polygon. */
 void ConvexPolygon::set_color (double R, double G, double B) {
 	r = R; g = G; b = B;
 }
 
+/** Gets the color of the polygon. */
+void ConvexPolygon::color (double& R, double& G, double& B) const {
+	R = r; G = g; B = b;
+}
+
 /** Enlarges this, so it becomes a convex union of this with another polygon. */
 ConvexPolygon& ConvexPolygon::operator+= (const ConvexPolygon& cpol) {
+	materialize();
+	if (cpol.transformed()) return *this += cpol.applied();
+
 	// Concatenation of vectors of points
-	for (const Point& p : cpol.theVertices) {
-		theVertices.push_back(p);
-	}
-	theVertices = convex_hull(theVertices);
+	vector<Point> points = vertices();
+	points.insert(points.end(), cpol.vertices().begin(), cpol.vertices().end());
+	set_vertices(convex_hull(points));
 	return *this;
 }
 
@@ -154,35 +475,30 @@ ConvexPolygon ConvexPolygon::operator+ (const ConvexPolygon& cpol) const {
 
 /** Sets and returns this as the smallest rectangle that contains all polygons. */
 ConvexPolygon ConvexPolygon::bounding_box (const vector<ConvexPolygon>& polygons) {
-	double x_min = polygons[0].vertices()[0].X(), x_max = x_min;
-	double y_min = polygons[0].vertices()[0].Y(), y_max = y_min;
-	for (const ConvexPolygon& cp : polygons) {
-		for (const Point& p : cp.vertices()) {
-			if (p.X() < x_min) x_min = p.X();
-			else if (p.X() > x_max) x_max = p.X();
-			if (p.Y() < y_min) y_min = p.Y();
-			else if (p.Y() > y_max) y_max = p.Y();
-		}
-	}
-	vector<Point> vertices_bbox = {Point(x_min, y_min), Point(x_max, y_min), Point(x_min, y_max), Point(x_max, y_max)};
-	*this = ConvexPolygon(vertices_bbox);
-	return *this;
+	Point LL, UR;
+	return bounding_box(polygons, LL, UR);
 }
 
 /** Sets and returns this as the smallest rectangle that contains all polygons. Also changes the coordinates
- * of the lower left and upper right.
+ * of the lower left and upper right. Polygons without vertices (empty intersections) are ignored.
  */
 ConvexPolygon ConvexPolygon::bounding_box (const vector<ConvexPolygon>& polygons, Point& LL, Point& UR) {
-	double x_min = polygons[0].vertices()[0].X(), x_max = x_min;
-	double y_min = polygons[0].vertices()[0].Y(), y_max = y_min;
+	double x_min = INFINITY, x_max = -INFINITY;
+	double y_min = INFINITY, y_max = -INFINITY;
 	for (const ConvexPolygon& cp : polygons) {
-		for (const Point& p : cp.vertices()) {
+		for (const Point& vertex : cp.vertices()) {
+			Point p = cp.apply(vertex);
 			if (p.X() < x_min) x_min = p.X();
-			else if (p.X() > x_max) x_max = p.X();
+			if (p.X() > x_max) x_max = p.X();
 			if (p.Y() < y_min) y_min = p.Y();
-			else if (p.Y() > y_max) y_max = p.Y();
+			if (p.Y() > y_max) y_max = p.Y();
 		}
 	}
+	if (x_min > x_max) {
+		set_vertices(nullptr, 0);
+		clear_transform();
+		return *this;
+	}
 	LL = Point(x_min, y_min);
 	UR = Point(x_max, y_max);
 	vector<Point> vertices_bbox = {Point(x_min, y_min), Point(x_max, y_min), Point(x_min, y_max), Point(x_max, y_max)};
@@ -190,40 +506,55 @@ ConvexPolygon ConvexPolygon::bounding_box (const vector<ConvexPolygon>& polygons
 	return *this;
 }
 
-/** Tells whether a point is inside a triangle by checking if all
- * vertex-vertex-point turns are counter-clockwise.
+/** Tells whether a point is inside a triangle (or on its sides) by checking
+ * that no vertex-vertex-point turn is clockwise.
  */
 bool ConvexPolygon::p_inside_triangle(const Point& p) const {
-	bool turn_a = cross_p(vertices()[0], vertices()[1], p) >= 1e-12;
-	bool turn_b = cross_p(vertices()[1], vertices()[2], p) >= 1e-12;
-	bool turn_c = cross_p(vertices()[2], vertices()[0], p) >= 1e-12;
+	bool turn_a = not_clockwise(vertices()[0], vertices()[1], p);
+	bool turn_b = not_clockwise(vertices()[1], vertices()[2], p);
+	bool turn_c = not_clockwise(vertices()[2], vertices()[0], p);
 	return turn_a and turn_b and turn_c;
 }
 
-/** Tells whether a point is inside this polygon. 
- *  It uses a divide and conquer algorithm that divides each polygon into
- *  two smaller ones and a triangle, then recursively checking for each one.
-*/
-bool ConvexPolygon::p_is_inside (const Point& p) const {
-	int n = vertices().size();
+/** Tells whether a point is inside this polygon (or on its boundary).
+ *  Triangles and rectangles with horizontal and vertical sides are checked directly.
+ *  Otherwise, the triangle of the fan from the first vertex that may contain the point
+ *  is found by binary search, without building any polygon: O(log n) complexity.
+ *  If the polygon has a transform, its inverse is applied to the point instead.
+ */
+bool ConvexPolygon::p_is_inside (const Point& point) const {
+	Point p = transformed() ? unapply(point) : point;
+	Vertices v = vertices();
+	int n = v.size();
 	if (n < 3) {
 		// If both points are the same
-		if (n == 1 and abs(vertices()[0].X()-p.X()) < 1e-12 and abs(vertices()[0].Y()-p.Y()) < 1e-12) return true;
-		// The three points are collinear
-		if (n == 2 and abs(cross_p(vertices()[0], vertices()[1], p)) < 1e-12) return true;
+		if (n == 1) {
+			double margin = 1e-12*max(magnitude(v[0]), magnitude(p));
+			return abs(v[0].X()-p.X()) <= margin and abs(v[0].Y()-p.Y()) <= margin;
+		}
+		// The three points are collinear (no turn either way) and p is between the other two
+		if (n == 2 and not_clockwise(v[0], v[1], p) and not_clockwise(v[1], v[0], p)) {
+			double margin = 1e-12*max(magnitude(v[0]), max(magnitude(v[1]), magnitude(p)));
+			return p.X() >= min(v[0].X(), v[1].X()) - margin and p.X() <= max(v[0].X(), v[1].X()) + margin
+				and p.Y() >= min(v[0].Y(), v[1].Y()) - margin and p.Y() <= max(v[0].Y(), v[1].Y()) + margin;
+		}
 		return false;
 	}
 	if (n == 3) return p_inside_triangle(p);
-	else {
-		auto middle = vertices().begin() + n/2;
-		vector<Point> v1(vertices().begin(), middle);
-		vector<Point> v2(middle, vertices().end()); v2.push_back(vertices()[0]);
-		vector<Point> vtriangle = {*(middle-1), *middle, vertices()[0]};
-		ConvexPolygon cpol1(v1, true);
-		ConvexPolygon cpol2(v2, true);
-		ConvexPolygon triangle(vtriangle, true);
-		return triangle.p_inside_triangle(p) or cpol1.p_is_inside(p) or cpol2.p_is_inside(p);
+	if (is_axis_rectangle()) {
+		// The sides are exact, so the margin only grows with the coordinates
+		double margin = 1e-12*max(magnitude(v[0]), max(magnitude(v[2]), magnitude(p)));
+		return p.X() >= v[0].X() - margin and p.X() <= v[2].X() + margin
+			and p.Y() >= v[0].Y() - margin and p.Y() <= v[2].Y() + margin;
+	}
+	if (not not_clockwise(v[0], v[1], p) or not not_clockwise(v[n-1], v[0], p)) return false;
+	int lo = 1, hi = n-1;	// p is not on the right of v[0]v[lo], nor on the left of v[0]v[hi]
+	while (hi - lo > 1) {
+		int mid = (lo + hi)/2;
+		if (cross_p(v[0], v[mid], p) >= 0) lo = mid;
+		else hi = mid;
 	}
+	return not_clockwise(v[lo], v[lo+1], p);
 }
 
 /** Tells whether this polygon is inside the input polygon.
@@ -231,33 +562,267 @@ bool ConvexPolygon::p_is_inside (const Point& p) const {
  */
 bool ConvexPolygon::is_inside (const ConvexPolygon& cpol) const {
 	bool inside = true;
-	for (const Point& p : vertices()) if (not cpol.p_is_inside(p)) inside = false;
+	for (const Point& p : vertices()) if (not cpol.p_is_inside(apply(p))) inside = false;
 	return inside;
 }
 
-/** Draws the list of polygons given as input. */
-void ConvexPolygon::draw (const char* img_name, const vector<ConvexPolygon>& lpol) const {
+/** Returns the point of segment ab closest to p. */
+static Point closest_on_segment (const Point& a, const Point& b, const Point& p) {
+	double dx = b.X() - a.X(), dy = b.Y() - a.Y();
+	double len2 = dx*dx + dy*dy;
+	double t = len2 > 0 ? ((p.X() - a.X())*dx + (p.Y() - a.Y())*dy) / len2 : 0;
+	t = max(0.0, min(1.0, t));
+	return Point(a.X() + t*dx, a.Y() + t*dy);
+}
+
+/** Tells whether the direction of a from o comes before (or is the same as) the one
+ *  of b, measuring the angles counter-clockwise from the direction of ref.
+ */
+static bool angle_before (const Point& o, const Point& ref, const Point& a, const Point& b) {
+	auto half = [&](const Point& u) {
+		double c = cross_p(o, ref, u);
+		double d = (ref.X() - o.X())*(u.X() - o.X()) + (ref.Y() - o.Y())*(u.Y() - o.Y());
+		return c < 0 or (c == 0 and d < 0);
+	};
+	bool ha = half(a), hb = half(b);
+	if (ha != hb) return hb;
+	return cross_p(o, a, b) >= 0;
+}
+
+/** Returns the index i of the edge (v[i], v[i+1]) of polygon v that is crossed by the ray
+ *  from o (strictly inside v) towards q. Binary search: O(log n) complexity.
+ */
+static int sector (const ConvexPolygon::Vertices& v, const Point& o, const Point& q) {
+	int lo = 0, hi = v.size();	// v[lo] comes before q, v[hi] (if any) does not.
+	while (hi - lo > 1) {
+		int mid = (lo + hi)/2;
+		if (angle_before(o, v[0], v[mid], q)) lo = mid;
+		else hi = mid;
+	}
+	return lo;
+}
+
+/** Computes the signed distance from p to the boundary of polygon v (at least 3 vertices,
+ *  counter-clockwise) and its closest point, using o, a point strictly inside v.
+ *	If p is outside, the edge crossed by the ray from o to p is visible from p, and the one
+ *	crossed by the opposite ray is not. The ends of the chain of visible edges are found by
+ *	binary search between them, and along this chain p projects past the end of each edge
+ *	until the closest one is reached, so it is found by binary search too: O(log n).
+ *	If p is inside, all edges are checked: O(n).
+ */
+static double signed_distance (const ConvexPolygon::Vertices& v, const Point& o, const Point& p, Point& nearest) {
+	int n = v.size();
+	auto edge = [&](int k) { return (k%n + n)%n; };
+	auto visible = [&](int k) { return cross_p(v[edge(k)], v[edge(k+1)], p) < 0; };
+
+	int s = sector(v, o, p);
+	if (not visible(s)) {
+		double best = INFINITY;
+		for (int i=0; i<n; ++i) {
+			Point c = closest_on_segment(v[i], v[edge(i+1)], p);
+			double d = c.distance(p);
+			if (d < best) { best = d; nearest = c; }
+		}
+		return best == 0 ? 0 : -best;
+	}
+
+	// Edges are numbered from the one that is not visible, m, so the visible ones are [a, b].
+	int m = sector(v, o, Point(2*o.X() - p.X(), 2*o.Y() - p.Y()));
+	int ds = edge(s - m);
+	int lo = 0, hi = ds;	// Not visible at lo, visible at hi
+	while (hi - lo > 1) {
+		int mid = (lo + hi)/2;
+		if (visible(m + mid)) hi = mid;
+		else lo = mid;
+	}
+	int a = hi;
+	lo = ds; hi = n;	// Visible at lo, not visible at hi
+	while (hi - lo > 1) {
+		int mid = (lo + hi)/2;
+		if (visible(m + mid)) lo = mid;
+		else hi = mid;
+	}
+	int b = lo;
+
+	// First edge of the chain such that p does not project past its end.
+	auto before_end = [&](int k) {
+		const Point& q = v[edge(k)];
+		const Point& r = v[edge(k+1)];
+		return (p.X() - r.X())*(r.X() - q.X()) + (p.Y() - r.Y())*(r.Y() - q.Y()) < 0;
+	};
+	lo = a - 1; hi = b;	// Past the end at lo (or before the chain), hi is the last candidate
+	while (hi - lo > 1) {
+		int mid = (lo + hi)/2;
+		if (before_end(m + mid)) hi = mid;
+		else lo = mid;
+	}
+	nearest = closest_on_segment(v[edge(m + hi)], v[edge(m + hi + 1)], p);
+	return nearest.distance(p);
+}
+
+/** Returns a point strictly inside polygon v (at least 3 vertices). */
+static Point interior_point (const ConvexPolygon::Vertices& v) {
+	int n = v.size();
+	const Point& a = v[0];
+	const Point& b = v[n/3];
+	const Point& c = v[2*n/3];
+	return Point((a.X() + b.X() + c.X())/3, (a.Y() + b.Y() + c.Y())/3);
+}
+
+/** Returns the distance from a point to the boundary of the polygon, negative if the
+ *  point is inside, and places the closest point of the boundary in nearest.
+ *  O(log n) complexity for points outside the polygon and O(n) for points inside.
+ */
+double ConvexPolygon::signed_distance (const Point& p, Point& nearest) const {
+	double factor;
+	if (transformed()) {
+		if (not similarity(factor)) return applied().signed_distance(p, nearest);
+		double d = factor*untransformed().signed_distance(unapply(p), nearest);
+		nearest = apply(nearest);
+		return d;
+	}
+	Vertices v = vertices();
+	if (v.size() < 3) {
+		nearest = closest_on_segment(v[0], v.back(), p);
+		return nearest.distance(p);
+	}
+	return ::signed_distance(v, interior_point(v), p, nearest);
+}
+
+/** Computes the signed distance and the closest point of the boundary for every point given.
+ *  The interior point used by the searches is only computed once.
+ */
+void ConvexPolygon::signed_distances (const vector<Point>& points, vector<double>& distances, vector<Point>& nearest) const {
+	double factor;
+	if (transformed()) {
+		if (not similarity(factor)) return applied().signed_distances(points, distances, nearest);
+		vector<Point> moved(points.size());
+		for (int i=0; i<int(points.size()); ++i) moved[i] = unapply(points[i]);
+		untransformed().signed_distances(moved, distances, nearest);
+		for (int i=0; i<int(points.size()); ++i) {
+			distances[i] *= factor;
+			nearest[i] = apply(nearest[i]);
+		}
+		return;
+	}
+	Vertices v = vertices();
+	int k = points.size();
+	distances.resize(k);
+	nearest.resize(k);
+	if (v.size() < 3) {
+		for (int i=0; i<k; ++i) distances[i] = signed_distance(points[i], nearest[i]);
+		return;
+	}
+	Point o = interior_point(v);
+	for (int i=0; i<k; ++i) distances[i] = ::signed_distance(v, o, points[i], nearest[i]);
+}
+
+/** Tells whether some edge of polygon p (with at least 3 vertices, counter-clockwise) leaves
+ *  all the points of q strictly on its right. The vertex of q furthest to the left of an
+ *  edge only moves forward as the edges of p turn, so it is found with a pointer that goes
+ *  around q once (rotating calipers): O(n+m) complexity.
+ */
+static bool separated_by_edge (const ConvexPolygon::Vertices& p, const ConvexPolygon::Vertices& q) {
+	int n = p.size(), m = q.size();
+	int j = 0;
+	for (int k=1; k<m; ++k) if (cross_p(p[0], p[1], q[k]) > cross_p(p[0], p[1], q[j])) j = k;
+	for (int i=0; i<n; ++i) {
+		const Point& a = p[i];
+		const Point& b = p[(i+1)%n];
+		for (int steps=0; steps<m and cross_p(a, b, q[(j+1)%m]) >= cross_p(a, b, q[j]); ++steps) j = (j+1)%m;
+		if (cross_p(a, b, q[j]) < -1e-12) return true;
+	}
+	return false;
+}
+
+/** Tells whether this polygon and another one have some point in common.
+ *  It uses the separating axis theorem: two convex polygons are disjoint if and only if
+ *  some edge of one of them separates them. Points and segments also need the directions of
+ *  their sides as axes, so those are checked by projecting both polygons on them.
+ */
+bool ConvexPolygon::overlaps (const ConvexPolygon& cpol) const {
+	if (transformed() or cpol.transformed()) return applied().overlaps(cpol.applied());
+	Vertices p = vertices();
+	Vertices q = cpol.vertices();
+	if (p.empty() or q.empty()) return false;
+	if (p.size() >= 3 and separated_by_edge(p, q)) return false;
+	if (q.size() >= 3 and separated_by_edge(q, p)) return false;
+
+	// Axes of points and segments.
+	vector<Point> axes;
+	for (const Vertices* v : {&p, &q}) {
+		if (v->size() == 2) {
+			Point d = (*v)[1] - (*v)[0];
+			axes.push_back(d);
+			axes.push_back(Point(-d.Y(), d.X()));
+		}
+	}
+	if (p.size() == 1 and q.size() == 1) axes.push_back(q[0] - p[0]);
+
+	for (const Point& axis : axes) {
+		double p_min = INFINITY, p_max = -INFINITY, q_min = INFINITY, q_max = -INFINITY;
+		for (const Point& v : p) {
+			double proj = v.X()*axis.X() + v.Y()*axis.Y();
+			p_min = min(p_min, proj); p_max = max(p_max, proj);
+		}
+		for (const Point& v : q) {
+			double proj = v.X()*axis.X() + v.Y()*axis.Y();
+			q_min = min(q_min, proj); q_max = max(q_max, proj);
+		}
+		if (p_max < q_min - 1e-12 or q_max < p_min - 1e-12) return false;
+	}
+	return true;
+}
+
+/** Draws the list of polygons given as input. The drawing is an SVG file if the name ends
+ *  in .svg, and a PNG image otherwise. Returns false if the file cannot be written.
+ */
+bool ConvexPolygon::draw (const char* img_name, const vector<ConvexPolygon>& lpol) const {
+	if (SvgWriter::is_svg(img_name)) {
+		SvgWriter svg;
+		for (const ConvexPolygon& pol : lpol) svg.fit(pol);
+		if (not svg.open(img_name)) return false;
+		for (const ConvexPolygon& pol : lpol) svg.write(pol);
+		return svg.close();
+	}
+
+	// pngwriter does not tell whether the image could be written, so the file is created
+	// first, and it must not be empty afterwards.
+	FILE* f = fopen(img_name, "wb");
+	if (f == nullptr) return false;
+	fclose(f);
+
 	Point LL, UR;
 	ConvexPolygon box;
 	box.bounding_box(lpol, LL, UR);
 	const int size = 500;
-	int scale = min(((size-4))/(UR.Y()-LL.Y()), ((size-4))/(UR.X()-LL.X())); // Scale factor: to fill the whole space.
-	Point centroid = box.centroid();
-	Point scaled_centroid = Point(scale*(centroid.X() - LL.X()) + 2, scale*(centroid.Y() - LL.Y()) + 2);
-	Point displacement = Point(250, 250) - scaled_centroid; // Used to center all elements in the image.
 	pngwriter png(size, size, 1.0, img_name);
-	for (const ConvexPolygon& pol : lpol) {
-		int n = pol.vertices().size(); ++n;
-		int points[2*n], i=0;
-		for (const Point& p : pol.vertices()) {
-			points[i++] = scale*(p.X() - LL.X()) + 2 + displacement.X();
-			points[i++] = scale*(p.Y() - LL.Y()) + 2 + displacement.Y();
+
+	// If all polygons are empty, the image is blank.
+	if (not box.vertices().empty()) {
+		// Scale factor: to fill the whole space (a single point is not scaled).
+		double extent = max(UR.X() - LL.X(), UR.Y() - LL.Y());
+		int scale = extent > 0 ? int(min((size-4)/extent, double(INT_MAX))) : 1;
+		Point centroid = box.centroid();
+		Point scaled_centroid = Point(scale*(centroid.X() - LL.X()) + 2, scale*(centroid.Y() - LL.Y()) + 2);
+		Point displacement = Point(250, 250) - scaled_centroid; // Used to center all elements in the image.
+		for (const ConvexPolygon& pol : lpol) {
+			if (pol.vertices().empty()) continue;
+			int n = pol.vertices().size(); ++n;
+			int points[2*n], i=0;
+			for (const Point& vertex : pol.vertices()) {
+				Point p = pol.apply(vertex);
+				points[i++] = scale*(p.X() - LL.X()) + 2 + displacement.X();
+				points[i++] = scale*(p.Y() - LL.Y()) + 2 + displacement.Y();
+			}
+			points[i++] = points[0];
+			points[i++] = points[1];
+			png.polygon(points, n, pol.r, pol.g, pol.b);
 		}
-		points[i++] = scale*(pol.vertices()[0].X() - LL.X()) + 2 + displacement.X();
-		points[i++] = scale*(pol.vertices()[0].Y() - LL.Y()) + 2 + displacement.Y();
-		png.polygon(points, n, pol.r, pol.g, pol.b);
 	}
 	png.close();
+	struct stat st;
+	return stat(img_name, &st) == 0 and st.st_size > 0;
 }
 
 /** Returns true if an intersection between the given lines (r and s) is found and, 
@@ -281,10 +846,16 @@ static bool intersection_segments (const Point& r1, const Point& r2, const Point
 	double y = (rA*sC - sA*rC)/det;
 	intersection = Point{x, y};
 
-	vector<Point> bbox_vert = {r1, r2, s1, s2};
-	ConvexPolygon bbox(bbox_vert);
-	if (bbox.p_is_inside(intersection)) return true;
-	return false;
+	// The intersection of the lines must lie on both segments (or at their ends). The
+	// rounding errors of the solution grow with the coordinates, and so does the margin.
+	double scale = 0;
+	for (const Point& p : {r1, r2, s1, s2}) scale = max(scale, max(abs(p.X()), abs(p.Y())));
+	double margin = 1e-9*scale;
+	auto on_segment = [&](const Point& a, const Point& b) {
+		return x >= min(a.X(), b.X()) - margin and x <= max(a.X(), b.X()) + margin
+			and y >= min(a.Y(), b.Y()) - margin and y <= max(a.Y(), b.Y()) + margin;
+	};
+	return on_segment(r1, r2) and on_segment(s1, s2);
 }
 
 /** Returns the points of a polygon that are inside of this polygon. */
@@ -300,8 +871,23 @@ vector<Point> ConvexPolygon::list_points_inside (const ConvexPolygon& cpol) cons
  *  It finds the vertices of one polygon that lay inside of the other. It then checks
  *  for all possible intersections between sides and adds them to the list. It finally
  *  computes the convex hull of all points and returns it.
+ *  Two rectangles with horizontal and vertical sides are intersected directly.
  */
 ConvexPolygon& ConvexPolygon::operator*= (const ConvexPolygon& cpol) {
+	materialize();
+	if (cpol.transformed()) return *this *= cpol.applied();
+
+	if (is_axis_rectangle() and cpol.is_axis_rectangle()) {
+		Vertices p = vertices(), q = cpol.vertices();
+		double x_min = max(p[0].X(), q[0].X()), x_max = min(p[2].X(), q[2].X());
+		double y_min = max(p[0].Y(), q[0].Y()), y_max = min(p[2].Y(), q[2].Y());
+		if (x_max - x_min > 1e-12 and y_max - y_min > 1e-12) {
+			Point corners[4] = {Point(x_min, y_min), Point(x_max, y_min), Point(x_max, y_max), Point(x_min, y_max)};
+			set_vertices(corners, 4);
+			return *this;
+		}
+	}
+
 	vector<Point> intersection_vertices;
 
 	// Finding the vertices that lay inside a polygon.
@@ -320,7 +906,7 @@ ConvexPolygon& ConvexPolygon::operator*= (const ConvexPolygon& cpol) {
 			}
 		}
 	}
-	theVertices = ConvexPolygon(intersection_vertices).vertices();
+	share_vertices(ConvexPolygon(intersection_vertices));
 	return *this;
 }
 
@@ -331,12 +917,125 @@ ConvexPolygon ConvexPolygon::operator* (const ConvexPolygon& cpol) const {
 	return dpol;
 }
 
+/*	A half-plane: the points on the left of the line that goes through p with direction d. */
+struct HalfPlane {
+	Point p, d;
+	double angle;	// Angle of d, used to sort the half-planes
+
+	// Tells whether a point is strictly outside the half-plane. The cross product is compared
+	// with the tolerance, so it grows with the length of d.
+	bool out (const Point& q, double tolerance) const {
+		return d.X()*(q.Y() - p.Y()) - d.Y()*(q.X() - p.X()) < -tolerance;
+	}
+};
+
+/** Returns the intersection point of the lines of two half-planes (which must not be parallel). */
+static Point line_intersection (const HalfPlane& s, const HalfPlane& t) {
+	double det = s.d.X()*t.d.Y() - s.d.Y()*t.d.X();
+	double u = ((t.p.X() - s.p.X())*t.d.Y() - (t.p.Y() - s.p.Y())*t.d.X())/det;
+	return Point(s.p.X() + u*s.d.X(), s.p.Y() + u*s.d.Y());
+}
+
+/** Sets this as the intersection of all polygons and returns it. The color is not changed.
+ *  Every edge of every polygon is the boundary of a half-plane that contains the polygon,
+ *  so the intersection is the intersection of all these half-planes. They are sorted by angle
+ *  and swept keeping a deque of the ones that bound the result (O(N log N) complexity, where N
+ *  is the total number of vertices). It stops as soon as the result is known to be empty.
+ */
+ConvexPolygon& ConvexPolygon::intersection (const vector<ConvexPolygon>& polygons) {
+	for (const ConvexPolygon& cpol : polygons) {
+		if (cpol.transformed()) {
+			vector<ConvexPolygon> applied_polygons;
+			for (const ConvexPolygon& cp : polygons) applied_polygons.push_back(cp.applied());
+			return intersection(applied_polygons);
+		}
+	}
+	set_vertices(nullptr, 0);
+	clear_transform();
+	if (polygons.empty()) return *this;
+
+	// Polygons with less than three vertices have no half-planes: they are intersected pairwise.
+	for (const ConvexPolygon& cpol : polygons) {
+		if (cpol.vertices().size() < 3) {
+			ConvexPolygon result = polygons[0];
+			for (int i=1; i<int(polygons.size()) and not result.vertices().empty(); ++i) result *= polygons[i];
+			share_vertices(result);
+			return *this;
+		}
+	}
+
+	// If the bounding boxes do not overlap, the intersection is empty.
+	double x_min = -INFINITY, x_max = INFINITY, y_min = -INFINITY, y_max = INFINITY;
+	double size = 0;	// Largest side of the boxes
+	for (const ConvexPolygon& cpol : polygons) {
+		double cx_min = INFINITY, cx_max = -INFINITY, cy_min = INFINITY, cy_max = -INFINITY;
+		for (const Point& p : cpol.vertices()) {
+			cx_min = min(cx_min, p.X()); cx_max = max(cx_max, p.X());
+			cy_min = min(cy_min, p.Y()); cy_max = max(cy_max, p.Y());
+		}
+		x_min = max(x_min, cx_min); x_max = min(x_max, cx_max);
+		y_min = max(y_min, cy_min); y_max = min(y_max, cy_max);
+		if (x_min > x_max or y_min > y_max) return *this;
+		size = max(size, max(cx_max - cx_min, cy_max - cy_min));
+	}
+
+	// Rectangles with horizontal and vertical sides intersect in the intersection of their boxes.
+	bool rectangles = true;
+	for (const ConvexPolygon& cpol : polygons) rectangles = rectangles and cpol.is_axis_rectangle();
+	if (rectangles and x_max - x_min > 1e-12 and y_max - y_min > 1e-12) {
+		Point corners[4] = {Point(x_min, y_min), Point(x_max, y_min), Point(x_max, y_max), Point(x_min, y_max)};
+		set_vertices(corners, 4);
+		return *this;
+	}
+
+	// Half-planes of all edges, sorted by angle.
+	vector<HalfPlane> planes;
+	for (const ConvexPolygon& cpol : polygons) {
+		int n = cpol.vertices().size();
+		for (int i=0; i<n; ++i) {
+			Point d = cpol.vertices()[(i+1)%n] - cpol.vertices()[i];
+			planes.push_back({cpol.vertices()[i], d, atan2(d.Y(), d.X())});
+		}
+	}
+	sort(planes.begin(), planes.end(), [](const HalfPlane& s, const HalfPlane& t) { return s.angle < t.angle; });
+
+	// Sweep keeping the half-planes that bound the result in a deque (dq[first..last-1]).
+	// Cross products of the edges grow with the square of the size of the polygons, and so
+	// does the tolerance, as in convex_hull, so small polygons are not taken as empty.
+	double tolerance = 1e-12*size*size;
+	int N = planes.size();
+	vector<HalfPlane> dq(N);
+	int first = 0, last = 0;
+	for (const HalfPlane& h : planes) {
+		while (last - first >= 2 and h.out(line_intersection(dq[last-1], dq[last-2]), tolerance)) --last;
+		while (last - first >= 2 and h.out(line_intersection(dq[first], dq[first+1]), tolerance)) ++first;
+		if (last - first >= 1 and abs(h.d.X()*dq[last-1].d.Y() - h.d.Y()*dq[last-1].d.X()) < tolerance) {
+			// Parallel half-planes: opposite ones leave nothing, otherwise the inner one is kept.
+			if (h.d.X()*dq[last-1].d.X() + h.d.Y()*dq[last-1].d.Y() < 0) return *this;
+			if (h.out(dq[last-1].p, tolerance)) dq[last-1] = h;
+			continue;
+		}
+		dq[last++] = h;
+	}
+	while (last - first >= 3 and dq[first].out(line_intersection(dq[last-1], dq[last-2]), tolerance)) --last;
+	while (last - first >= 3 and dq[last-1].out(line_intersection(dq[first], dq[first+1]), tolerance)) ++first;
+	if (last - first < 3) return *this;
+
+	// The vertices are the intersections of consecutive half-planes.
+	vector<Point> points;
+	for (int i=first; i<last; ++i) points.push_back(line_intersection(dq[i], dq[i+1 < last ? i+1 : first]));
+	set_vertices(convex_hull(points));
+	return *this;
+}
+
 /** Tells whether the polygon is regular or not. 
  *  It first checks for all sides then for all angles.
  */
 bool ConvexPolygon::is_regular () const {
+	if (transformed()) return applied().is_regular();
 	// Checking for all sides
 	int n = vertices().size();
+	if (n < 3) return false;
 	double dist = vertices()[n-1].distance(vertices()[0]);
 	for (int i=1, ii=0; i<n; ii=i++) {
 		if (abs(dist - vertices()[ii].distance(vertices()[i])) > 1e-12) return false;
@@ -350,3 +1049,42 @@ bool ConvexPolygon::is_regular () const {
 	}
 	return true;
 }
+
+/** Returns the distance from point p to the line that goes through a and b. */
+static double distance_to_line (const Point& a, const Point& b, const Point& p) {
+	return abs(cross_p(a, b, p))/a.distance(b);
+}
+
+/** Removes vertices so that no point of the polygon is further than tolerance from the
+ *  result, which is inside the original polygon (Hausdorff distance at most tolerance).
+ *  It greedily extends a chord from the last kept vertex while all the vertices it skips
+ *  are close enough to it. The distance to the chord is unimodal along the skipped chain,
+ *  so the farthest vertex is tracked with a pointer that only moves forward: O(n) complexity.
+ */
+ConvexPolygon& ConvexPolygon::simplify (double tolerance) {
+	materialize();
+	int n = vertices().size();
+	if (n <= 3) return *this;
+
+	vector<Point> kept = {vertices()[0]};
+	int a = 0;		// Last kept vertex
+	int far = 1;	// The skipped vertex farthest from the chord
+	for (int c = 2; c <= n; ++c) { // c == n closes the polygon with vertex 0
+		const Point& pa = vertices()[a];
+		const Point& pc = vertices()[c%n];
+		while (far + 1 < c and distance_to_line(pa, pc, vertices()[far+1]) >= distance_to_line(pa, pc, vertices()[far])) ++far;
+
+		// The skipped vertices must also project inside the chord, which happens when
+		// both the first and last skipped edges go in the direction of the chord.
+		Point chord = pc - pa;
+		Point first = vertices()[a+1] - pa, last = pc - vertices()[c-1];
+		bool forward = first.X()*chord.X() + first.Y()*chord.Y() > 0 and last.X()*chord.X() + last.Y()*chord.Y() > 0;
+		if (not forward or distance_to_line(pa, pc, vertices()[far]) > tolerance) {
+			a = c - 1;
+			far = c;
+			kept.push_back(vertices()[a]);
+		}
+	}
+	if (kept.size() >= 3) set_vertices(kept);
+	return *this;
+}
@@ -2,6 +2,7 @@
 #define ConvexPolygon_h
 
 #include <vector>
+#include <memory>
 #include <algorithm>
 #include <cmath>
 #include <pngwriter.h>
@@ -11,14 +12,44 @@
 
 using namespace std;
 
+// Maximum number of vertices stored inside the polygon itself. The vertices of larger
+// polygons are stored in a buffer on the heap. It can be changed when compiling.
+#ifndef CONVEX_POLYGON_INLINE_VERTICES
+#define CONVEX_POLYGON_INLINE_VERTICES 8
+#endif
+
 /* 	This class stores a two dimensional convex polygon
  *	and provides some operations that can be done with it.
  */
 
 class ConvexPolygon {
 
+	// Writes polygons with their transforms applied.
+	friend class SvgWriter;
+
 public:
 
+	// Read-only sequence of the vertices of a polygon. It does not own them: it is only
+	// valid while the polygon is not modified nor destroyed, so it must not outlive it.
+	class Vertices {
+	public:
+		Vertices (const Point* first, size_t n) : first(first), n(n) {}
+		const Point* begin () const { return first; }
+		const Point* end () const { return first + n; }
+		size_t size () const { return n; }
+		bool empty () const { return n == 0; }
+		const Point& operator[] (size_t i) const { return first[i]; }
+		const Point& front () const { return first[0]; }
+		const Point& back () const { return first[n-1]; }
+
+		// Returns a copy of the vertices.
+		operator vector<Point> () const { return vector<Point>(first, first + n); }
+
+	private:
+		const Point* first;
+		size_t n;
+	};
+
 	// Default constructor
 	ConvexPolygon();
 
@@ -28,8 +59,13 @@ public:
 	// Constructor
 	ConvexPolygon(vector<Point>& points, bool points_sorted);
 
-	// Returns the vertices of the polygon in counter-clockwise order.
-	vector<Point> vertices () const;
+	// Returns the vertices of the polygon in counter-clockwise order, without applying
+	// its transform (see materialize).
+	Vertices vertices () const &;
+
+	// Returns a copy of the vertices of a temporary polygon, as a view of them would
+	// be left dangling (for instance in cpol.applied().vertices()).
+	vector<Point> vertices () const &&;
 
 	// Returns the perimeter of the polygon.
 	double perimeter () const;
@@ -37,12 +73,43 @@ public:
 	// Returns the area of the polygon.
 	double area () const;
 
-	// Returns the centroid of the polygon.
+	// Returns the centroid of the polygon (the origin if it is empty).
 	Point centroid () const;
 
+	// Computes the area, the perimeter and the centroid of the polygon in a single pass.
+	void metrics (double& area, double& perimeter, Point& centroid) const;
+
+	// Composes an affine transform with the one of the polygon, so each point (x, y) is moved to
+	// (a*x + b*y + c, d*x + e*y + f). The vertices are only changed by materialize. Returns this polygon.
+	ConvexPolygon& transform (double a, double b, double c, double d, double e, double f);
+
+	// Moves the polygon by (dx, dy). Returns this polygon.
+	ConvexPolygon& translate (double dx, double dy);
+
+	// Scales the polygon from the origin. Returns this polygon.
+	ConvexPolygon& scale (double sx, double sy);
+
+	// Rotates the polygon counter-clockwise around the origin (angle in degrees). Returns this polygon.
+	ConvexPolygon& rotate (double degrees);
+
+	// Tells whether the polygon has a transform that has not been applied to its vertices.
+	bool transformed () const;
+
+	// Tells whether the transform of the polygon can be undone (it does not collapse the plane).
+	bool invertible () const;
+
+	// Applies the transform of the polygon to its vertices. Returns this polygon.
+	ConvexPolygon& materialize ();
+
+	// Returns a copy of the polygon with its transform applied.
+	ConvexPolygon applied () const;
+
 	// Sets the color of the polygon.
 	void set_color (double R, double G, double B);
 
+	// Gets the color of the polygon.
+	void color (double& R, double& G, double& B) const;
+
 	// Enlarges this, so it becomes a convex union of this with another polygon.
 	ConvexPolygon& operator+= (const ConvexPolygon& cpol);
 
@@ -56,14 +123,26 @@ public:
 	// of the lower left and upper right.
 	ConvexPolygon bounding_box (const vector<ConvexPolygon>& polygons, Point& LL, Point& UR); 
 
-	// Tells whether a point is inside this polygon.
+	// Tells whether a point is inside this polygon or on its boundary. Points closer to the
+	// boundary than about 1e-12 times the size of the coordinates are on it.
 	bool p_is_inside (const Point& p) const;
 
 	// Tells whether this polygon is inside a polygon.
 	bool is_inside (const ConvexPolygon& cpol) const;
 
-	// Draws the list of polygons given as input.
-	void draw (const char* img_name, const vector<ConvexPolygon>& lpol) const;
+	// Returns the distance from a point to the boundary of the polygon, negative if the point is
+	// inside, and places the closest point of the boundary in nearest. The polygon cannot be empty.
+	double signed_distance (const Point& p, Point& nearest) const;
+
+	// Computes the signed distance and the closest point of the boundary for every point given.
+	void signed_distances (const vector<Point>& points, vector<double>& distances, vector<Point>& nearest) const;
+
+	// Tells whether this polygon and another one have some point in common.
+	bool overlaps (const ConvexPolygon& cpol) const;
+
+	// Draws the list of polygons given as input, as an SVG file if its name ends in .svg and
+	// as a PNG image otherwise. Returns false if the file cannot be written.
+	bool draw (const char* img_name, const vector<ConvexPolygon>& lpol) const;
 
 	// Intersects this polygon with another one and returns this polygon.
 	ConvexPolygon& operator*= (const ConvexPolygon& cpol);
@@ -71,23 +150,68 @@ public:
 	// Returns the intersection of this polygon with another one.
 	ConvexPolygon operator* (const ConvexPolygon& cpol) const;
 
+	// Sets this as the intersection of all polygons and returns it. The color is not changed.
+	ConvexPolygon& intersection (const vector<ConvexPolygon>& polygons);
+
 	// Tells whether the polygon is regular or not.
 	bool is_regular () const;
 
+	// Removes vertices so that no point of the polygon is further than tolerance from the
+	// result, which is inside the original polygon. Returns this polygon.
+	ConvexPolygon& simplify (double tolerance);
+
 private:
 
-	// Collection of the vertices of the polygon ordered counter-clockwise.
-	vector<Point> theVertices;
+	// Number of vertices of the polygon.
+	int n_vertices;
+
+	// Vertices of the polygon ordered counter-clockwise, if there are few of them.
+	Point inline_vertices[CONVEX_POLYGON_INLINE_VERTICES];
+
+	// Vertices of the polygon ordered counter-clockwise, if there are more. The buffer
+	// is never modified, so copies of the polygon share it.
+	shared_ptr<const vector<Point>> theVertices;
+
+	// Colour of the polygon (black unless it is set)
+	double r = 0, g = 0, b = 0;
+
+	// Affine transform not yet applied to the vertices: (x, y) is moved to
+	// (affine[0]*x + affine[1]*y + affine[2], affine[3]*x + affine[4]*y + affine[5]).
+	double affine[6] = {1, 0, 0, 0, 1, 0};
+
+	// Applies the transform to a point.
+	Point apply (const Point& p) const;
+
+	// Applies the inverse of the transform to a point.
+	Point unapply (const Point& p) const;
 
-	// Colour of the polygon
-	double r, g, b;
+	// Returns the determinant of the linear part of the transform.
+	double determinant () const;
+
+	// Tells whether the transform keeps the shapes, placing its scale factor in factor.
+	bool similarity (double& factor) const;
+
+	// Removes the transform without applying it.
+	void clear_transform ();
+
+	// Returns a copy of the polygon without its transform.
+	ConvexPolygon untransformed () const;
 
 	// Calculates the convex hull of a given set of points.
 	vector<Point> convex_hull(vector<Point>& points);
 	
-	// Removes last point of the vector of vertices.
-	void remove_last_vertex ();
-	
+	// Replaces the vector of vertices.
+	void set_vertices (vector<Point> points);
+
+	// Replaces the vertices with the n points starting at first.
+	void set_vertices (const Point* first, int n);
+
+	// Takes the vertices of another polygon.
+	void share_vertices (const ConvexPolygon& cpol);
+
+	// Tells whether the polygon is a rectangle with horizontal and vertical sides.
+	bool is_axis_rectangle () const;
+
 	// Tells whether a point is inside a triangle
 	bool p_inside_triangle (const Point& p) const;
 
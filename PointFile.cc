@@ -0,0 +1,129 @@
+#include "PointFile.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+
+/* Longest number that is read with strtod. */
+static const int MAX_NUMBER = 128;
+
+
+/** Constructor. Maps the file into memory. */
+PointFile::PointFile (const string& path)
+:	data(nullptr),
+	size(0)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return;
+	struct stat st;
+	if (fstat(fd, &st) == 0) {
+		if (st.st_size == 0) data = "";	// Empty files cannot be mapped
+		else {
+			void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr != MAP_FAILED) {
+				data = (const char*) addr;
+				size = st.st_size;
+				madvise(addr, size, MADV_SEQUENTIAL);
+			}
+		}
+	}
+	close(fd);
+}
+
+/** Destructor. Unmaps the file. */
+PointFile::~PointFile () {
+	if (size > 0) munmap((void*) data, size);
+}
+
+/** Tells whether the file could be mapped. */
+bool PointFile::is_open () const {
+	return data != nullptr;
+}
+
+/** Returns the length of the file in bytes. */
+size_t PointFile::length () const {
+	return size;
+}
+
+/** Returns the position of the first line that starts at offset or after it. */
+size_t PointFile::line_start (size_t offset) const {
+	if (offset == 0) return 0;
+	if (offset >= size) return size;
+	const char* nl = (const char*) memchr(data + offset - 1, '\n', size - offset + 1);
+	return nl == nullptr ? size : nl - data + 1;
+}
+
+/* Powers of ten that are exact as doubles. */
+static const double POWERS_OF_TEN[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/** Reads a number in plain decimal notation (such as -12.375) from s, before end, and moves
+ *  s after it. Returns false if it is not one. With at most 15 digits both the digits and the
+ *  power of ten are exact doubles, so dividing them gives the same result as strtod.
+ *  Other numbers (with more digits or with exponents) are left to strtod.
+ */
+static bool read_number (const char*& s, const char* end, double& v) {
+	const char* first = s;
+	bool negative = s < end and *s == '-';
+	if (s < end and (*s == '-' or *s == '+')) ++s;
+	uint64_t digits = 0;
+	int n_digits = 0, decimals = 0;
+	bool point = false;
+	for (; s < end; ++s) {
+		if (*s >= '0' and *s <= '9') {
+			digits = 10*digits + (*s - '0');
+			++n_digits;
+			if (point) ++decimals;
+		}
+		else if (*s == '.' and not point) point = true;
+		else break;
+	}
+	bool exponent = s < end and (*s == 'e' or *s == 'E');
+	if (n_digits > 0 and n_digits <= 15 and not exponent) {
+		v = double(digits)/POWERS_OF_TEN[decimals];
+		if (negative) v = -v;
+		return true;
+	}
+
+	// The mapping is not null-terminated, so the number is copied before calling strtod.
+	char number[MAX_NUMBER + 1];
+	size_t n = min(size_t(end - first), size_t(MAX_NUMBER));
+	memcpy(number, first, n);
+	number[n] = '\0';
+	char* rest;
+	v = strtod(number, &rest);
+	s = first + (rest - number);
+	return rest != number;
+}
+
+/** Reads the next point from the lines that start at pos or after it, and before end.
+ *  Moves pos after its line. Returns false if there are no more points.
+ */
+bool PointFile::next (size_t& pos, size_t end, Point& p) const {
+	while (pos < end) {
+		const char* s = data + pos;
+		const char* nl = (const char*) memchr(s, '\n', size - pos);
+		const char* line_end = nl == nullptr ? data + size : nl;
+		pos = line_end - data + 1;
+
+		while (s < line_end and (*s == ' ' or *s == '\t')) ++s;
+		double x, y;
+		if (not read_number(s, line_end, x)) continue;
+		const char* sep = s;
+		while (s < line_end and (*s == ',' or *s == ' ' or *s == '\t' or *s == ';')) ++s;
+		if (s == sep or not read_number(s, line_end, y)) continue;
+		p = Point(x, y);
+		return true;
+	}
+	return false;
+}
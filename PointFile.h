@@ -0,0 +1,50 @@
+#ifndef PointFile_h
+#define PointFile_h
+
+#include <string>
+#include "Point.h"
+
+using namespace std;
+
+/* 	This class reads a text file of points, one point per line with its coordinates
+ *	separated by a comma or by spaces (as in "1.5,-2" or "1.5 -2"; further columns are
+ *	ignored). The file is mapped into memory, so parts of it can be read at the same
+ *	time from several threads. Lines that do not start with two numbers are skipped.
+ */
+
+class PointFile {
+
+public:
+
+	// Constructor. Maps the file into memory.
+	PointFile (const string& path);
+
+	// Destructor. Unmaps the file.
+	~PointFile ();
+
+	// Tells whether the file could be mapped.
+	bool is_open () const;
+
+	// Returns the length of the file in bytes.
+	size_t length () const;
+
+	// Returns the position of the first line that starts at offset or after it.
+	size_t line_start (size_t offset) const;
+
+	// Reads the next point from the lines that start at pos or after it, and before end.
+	// Moves pos after its line. Returns false if there are no more points.
+	bool next (size_t& pos, size_t end, Point& p) const;
+
+private:
+
+	// Mapped file and its length.
+	const char* data;
+	size_t size;
+
+	// A mapping cannot be copied.
+	PointFile (const PointFile&);
+	PointFile& operator= (const PointFile&);
+
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "ResultCache.h"
+
+
+using namespace std;
+
+
+/** Constructor. The budget is given in bytes. */
+ResultCache::ResultCache(size_t budget)
+:	max_bytes(budget),
+	used_bytes(0),
+	n_hits(0),
+	n_misses(0)
+{
+	// Lookups must not keep insertions waiting (glibc prefers readers by default).
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+	pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+	pthread_rwlock_init(&lock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+}
+
+/** Destructor. */
+ResultCache::~ResultCache() {
+	pthread_rwlock_destroy(&lock);
+}
+
+/** Returns the entry with the given key (marking it as used) or null. Lookups only share
+ *  the lock, so the entry is not moved in the list: it is marked and eviction gives it
+ *  a second chance instead. The mark is only written when it changes, so that threads
+ *  finding the same result do not keep writing to it.
+ */
+const ResultCache::Entry* ResultCache::lookup (const string& key) {
+	auto it = index.find(key);
+	if (it == index.end()) {
+		n_misses.fetch_add(1, memory_order_relaxed);
+		return nullptr;
+	}
+	n_hits.fetch_add(1, memory_order_relaxed);
+	Entry& entry = *it->second;
+	if (not entry.used.load(memory_order_relaxed)) entry.used.store(true, memory_order_relaxed);
+	return &entry;
+}
+
+/** Stores a new entry with the given key as the newest one, replacing the previous result
+ *  if any, and returns it. Its memory must be counted with acquire once it is filled.
+ */
+ResultCache::Entry& ResultCache::store (const string& key) {
+	auto it = index.find(key);
+	if (it != index.end()) {
+		release(*it->second);
+		entries.erase(it->second);
+	}
+	entries.emplace_front();
+	Entry& entry = entries.front();
+	entry.key = key;
+	entry.number = 0;
+	entry.bytes = sizeof(Entry) + key.size();	// The vertices are counted by acquire
+	entry.used = false;
+	index[key] = entries.begin();
+	return entry;
+}
+
+/** Removes results from the oldest one until the budget is satisfied. Results that were
+ *  found since they were stored are moved to the front instead, without their mark, so
+ *  the results that are used often are kept.
+ */
+void ResultCache::evict () {
+	while (used_bytes > max_bytes and not entries.empty()) {
+		Entry& oldest = entries.back();
+		if (oldest.used) {
+			oldest.used = false;
+			entries.splice(entries.begin(), entries, prev(entries.end()));
+			continue;
+		}
+		release(oldest);
+		index.erase(oldest.key);
+		entries.pop_back();
+	}
+}
+
+/** Counts the memory of an entry as used. The vertices of polygons stored on the heap
+ *  may be shared with other entries, so they are only counted by the first one.
+ */
+void ResultCache::acquire (const Entry& entry) {
+	used_bytes += entry.bytes;
+	ConvexPolygon::Vertices v = entry.polygon.vertices();
+	if (v.size() > CONVEX_POLYGON_INLINE_VERTICES and buffers[v.begin()]++ == 0) used_bytes += v.size()*sizeof(Point);
+}
+
+/** Counts the memory of an entry as no longer used. */
+void ResultCache::release (const Entry& entry) {
+	used_bytes -= entry.bytes;
+	ConvexPolygon::Vertices v = entry.polygon.vertices();
+	if (v.size() > CONVEX_POLYGON_INLINE_VERTICES and --buffers[v.begin()] == 0) {
+		buffers.erase(v.begin());
+		used_bytes -= v.size()*sizeof(Point);
+	}
+}
+
+/** Looks for a numeric result. Returns whether it was found. */
+bool ResultCache::find (const string& key, double& value) {
+	pthread_rwlock_rdlock(&lock);
+	const Entry* entry = lookup(key);
+	if (entry != nullptr) value = entry->number;
+	pthread_rwlock_unlock(&lock);
+	return entry != nullptr;
+}
+
+/** Looks for a polygon. Returns whether it was found. */
+bool ResultCache::find (const string& key, ConvexPolygon& value) {
+	pthread_rwlock_rdlock(&lock);
+	const Entry* entry = lookup(key);
+	if (entry != nullptr) value = entry->polygon;
+	pthread_rwlock_unlock(&lock);
+	return entry != nullptr;
+}
+
+/** Stores a numeric result. */
+void ResultCache::insert (const string& key, double value) {
+	pthread_rwlock_wrlock(&lock);
+	Entry& entry = store(key);
+	entry.number = value;
+	acquire(entry);
+	evict();
+	pthread_rwlock_unlock(&lock);
+}
+
+/** Stores a polygon. */
+void ResultCache::insert (const string& key, const ConvexPolygon& value) {
+	pthread_rwlock_wrlock(&lock);
+	Entry& entry = store(key);
+	entry.polygon = value;
+	acquire(entry);
+	evict();
+	pthread_rwlock_unlock(&lock);
+}
+
+/** Sets the memory budget (in bytes), removing results if needed. */
+void ResultCache::set_budget (size_t budget) {
+	pthread_rwlock_wrlock(&lock);
+	max_bytes = budget;
+	evict();
+	pthread_rwlock_unlock(&lock);
+}
+
+/** Returns the memory budget in bytes. */
+size_t ResultCache::budget () const {
+	pthread_rwlock_rdlock(&lock);
+	size_t bytes = max_bytes;
+	pthread_rwlock_unlock(&lock);
+	return bytes;
+}
+
+/** Returns the (estimated) memory used by the stored results in bytes. */
+size_t ResultCache::memory () const {
+	pthread_rwlock_rdlock(&lock);
+	size_t bytes = used_bytes;
+	pthread_rwlock_unlock(&lock);
+	return bytes;
+}
+
+/** Returns the number of lookups that found their result. */
+unsigned long ResultCache::hits () const {
+	return n_hits;
+}
+
+/** Returns the number of lookups that did not find their result. */
+unsigned long ResultCache::misses () const {
+	return n_misses;
+}
+
+/** Returns the fraction of lookups that found their result. */
+double ResultCache::hit_rate () const {
+	unsigned long h = n_hits, m = n_misses;
+	if (h + m == 0) return 0;
+	return double(h)/(h + m);
+}
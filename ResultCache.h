@@ -0,0 +1,111 @@
+#ifndef ResultCache_h
+#define ResultCache_h
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <atomic>
+#include <pthread.h>
+#include "ConvexPolygon.h"
+
+using namespace std;
+
+/* 	This class stores the results of queries done with polygons (numbers and polygons)
+ *	so that repeating a query is just a lookup. Each result is stored under a key that
+ *	must identify the query and the version of the polygons it was computed from.
+ *	When the memory used goes over the budget, results that have not been used recently
+ *	are removed (second chance, or clock, replacement).
+ *	It can be used from several threads at the same time: lookups only share the lock
+ *	of the cache, so they do not wait for each other.
+ */
+
+class ResultCache {
+
+public:
+
+	// Constructor. The budget is given in bytes.
+	ResultCache(size_t budget = 64 << 20);
+
+	// Destructor.
+	~ResultCache();
+
+	// Looks for a numeric result. Returns whether it was found.
+	bool find (const string& key, double& value);
+
+	// Looks for a polygon. Returns whether it was found.
+	bool find (const string& key, ConvexPolygon& value);
+
+	// Stores a numeric result.
+	void insert (const string& key, double value);
+
+	// Stores a polygon.
+	void insert (const string& key, const ConvexPolygon& value);
+
+	// Sets the memory budget (in bytes), removing results if needed.
+	void set_budget (size_t budget);
+
+	// Returns the memory budget in bytes.
+	size_t budget () const;
+
+	// Returns the (estimated) memory used by the stored results in bytes.
+	size_t memory () const;
+
+	// Returns the number of lookups that found their result.
+	unsigned long hits () const;
+
+	// Returns the number of lookups that did not find their result.
+	unsigned long misses () const;
+
+	// Returns the fraction of lookups that found their result.
+	double hit_rate () const;
+
+private:
+
+	// A stored result.
+	struct Entry {
+		string key;
+		double number;
+		ConvexPolygon polygon;
+		size_t bytes;
+		atomic<bool> used;	// Found since it was stored or last given a second chance
+	};
+
+	// Results from the newest to the oldest one. Eviction takes them from the back.
+	list<Entry> entries;
+
+	// Position of each result in the list.
+	unordered_map<string, list<Entry>::iterator> index;
+
+	// Memory budget and memory used (in bytes).
+	size_t max_bytes, used_bytes;
+
+	// Number of stored polygons that use each shared buffer of vertices (by its first
+	// vertex), so that the memory of a buffer is counted once.
+	unordered_map<const Point*, int> buffers;
+
+	// Statistics of the lookups.
+	atomic<unsigned long> n_hits, n_misses;
+
+	// Lock of the cache: shared by lookups, exclusive to change the results.
+	mutable pthread_rwlock_t lock;
+
+	// Returns the entry with the given key (marking it as used) or null. The lock must be held.
+	const Entry* lookup (const string& key);
+
+	// Stores a new entry with the given key as the newest one and returns it. The lock must be held.
+	Entry& store (const string& key);
+
+	// Removes results until the budget is satisfied. Used results get a second chance.
+	void evict ();
+
+	// Counts the memory of an entry as used, or as no longer used.
+	void acquire (const Entry& entry);
+	void release (const Entry& entry);
+
+	// A cache cannot be copied.
+	ResultCache (const ResultCache&);
+	ResultCache& operator= (const ResultCache&);
+
+};
+
+#endif
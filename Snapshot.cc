@@ -0,0 +1,134 @@
+#include "Snapshot.h"
+
+#include <fstream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+
+/* Identifies snapshot files (and the version of their format). */
+static const char MAGIC[8] = {'C', 'P', 'S', 'N', 'A', 'P', '0', '1'};
+
+
+/** Writes the named polygons to a snapshot file. Returns whether it could be written.
+ *  The file has a header, the descriptions of all polygons, their names and finally their
+ *  coordinates (which are kept aligned to 8 bytes).
+ */
+bool Snapshot::write (const string& path, const vector<pair<string, const ConvexPolygon*>>& polygons) {
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.n_polygons = polygons.size();
+
+	// Computing where everything goes.
+	vector<Entry> entries(polygons.size());
+	uint64_t offset = sizeof(Header) + polygons.size()*sizeof(Entry);
+	for (int i=0; i<int(polygons.size()); ++i) {
+		entries[i].name_offset = offset;
+		entries[i].name_length = polygons[i].first.size();
+		offset += polygons[i].first.size();
+	}
+	offset = (offset + 7)/8*8;
+	for (int i=0; i<int(polygons.size()); ++i) {
+		entries[i].vertices_offset = offset;
+		entries[i].n_vertices = polygons[i].second->vertices().size();
+		polygons[i].second->color(entries[i].r, entries[i].g, entries[i].b);
+		offset += 2*sizeof(double)*entries[i].n_vertices;
+	}
+
+	ofstream f(path, ios::binary);
+	f.write((const char*) &header, sizeof(header));
+	f.write((const char*) entries.data(), entries.size()*sizeof(Entry));
+	uint64_t written = sizeof(Header) + entries.size()*sizeof(Entry);
+	for (const auto& named : polygons) {
+		f.write(named.first.data(), named.first.size());
+		written += named.first.size();
+	}
+	const char padding[8] = {0};
+	f.write(padding, (8 - written%8)%8);
+	for (const auto& named : polygons) {
+		for (const Point& p : named.second->vertices()) {
+			double coords[2] = {p.X(), p.Y()};
+			f.write((const char*) coords, sizeof(coords));
+		}
+	}
+	f.close();
+	return bool(f);
+}
+
+/** Constructor. Maps the snapshot file into memory. */
+Snapshot::Snapshot (const string& path)
+:	data(nullptr),
+	length(0)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return;
+	struct stat st;
+	if (fstat(fd, &st) == 0 and st.st_size >= (off_t) sizeof(Header)) {
+		void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr != MAP_FAILED) {
+			data = (const char*) addr;
+			length = st.st_size;
+		}
+	}
+	close(fd);
+	if (data == nullptr) return;
+
+	// Checking that it is a snapshot and that everything is inside the file.
+	const Header* header = (const Header*) data;
+	bool valid = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0
+			 and header->n_polygons <= (length - sizeof(Header))/sizeof(Entry);
+	for (int i=0; valid and i<int(header->n_polygons); ++i) {
+		const Entry& e = entry(i);
+		valid = e.name_offset <= length and e.name_length <= length - e.name_offset
+			and e.vertices_offset%8 == 0 and e.vertices_offset <= length
+			and e.n_vertices <= (length - e.vertices_offset)/(2*sizeof(double));
+	}
+	if (not valid) {
+		munmap((void*) data, length);
+		data = nullptr;
+		length = 0;
+	}
+}
+
+/** Destructor. Unmaps the file. */
+Snapshot::~Snapshot () {
+	if (data != nullptr) munmap((void*) data, length);
+}
+
+/** Tells whether the file could be mapped and is a valid snapshot. */
+bool Snapshot::is_open () const {
+	return data != nullptr;
+}
+
+/** Returns the number of polygons in the snapshot. */
+int Snapshot::size () const {
+	return ((const Header*) data)->n_polygons;
+}
+
+/** Returns the description of the i-th polygon. */
+const Snapshot::Entry& Snapshot::entry (int i) const {
+	return ((const Entry*) (data + sizeof(Header)))[i];
+}
+
+/** Returns the name of the i-th polygon. */
+string Snapshot::name (int i) const {
+	return string(data + entry(i).name_offset, entry(i).name_length);
+}
+
+/** Returns the i-th polygon. Its vertices are already in order, so no hull is computed,
+ *  but they are copied out of the mapping: the polygon owns them like any other one.
+ */
+ConvexPolygon Snapshot::polygon (int i) const {
+	const Entry& e = entry(i);
+	const double* coords = (const double*) (data + e.vertices_offset);
+	vector<Point> points;
+	points.reserve(e.n_vertices);
+	for (uint64_t k=0; k<e.n_vertices; ++k) points.push_back(Point(coords[2*k], coords[2*k+1]));
+	ConvexPolygon cpol(points, true);
+	cpol.set_color(e.r, e.g, e.b);
+	return cpol;
+}
@@ -0,0 +1,70 @@
+#ifndef Snapshot_h
+#define Snapshot_h
+
+#include <string>
+#include <cstdint>
+#include "ConvexPolygon.h"
+
+using namespace std;
+
+/* 	This class gives access to a snapshot: a binary file with a set of named polygons
+ *	(their vertices in counter-clockwise order and their colors). The file only uses
+ *	offsets from its beginning, so it is mapped into memory as it is and polygons are
+ *	read from the mapping when they are needed, without parsing nor computing hulls.
+ */
+
+class Snapshot {
+
+public:
+
+	// Writes the named polygons to a snapshot file. Returns whether it could be written.
+	static bool write (const string& path, const vector<pair<string, const ConvexPolygon*>>& polygons);
+
+	// Constructor. Maps the snapshot file into memory.
+	Snapshot (const string& path);
+
+	// Destructor. Unmaps the file.
+	~Snapshot ();
+
+	// Tells whether the file could be mapped and is a valid snapshot.
+	bool is_open () const;
+
+	// Returns the number of polygons in the snapshot.
+	int size () const;
+
+	// Returns the name of the i-th polygon.
+	string name (int i) const;
+
+	// Returns the i-th polygon. Its vertices are copied out of the mapping, so the
+	// polygon stays valid after the snapshot is destroyed.
+	ConvexPolygon polygon (int i) const;
+
+private:
+
+	// Beginning of the file.
+	struct Header {
+		char magic[8];
+		uint64_t n_polygons;
+	};
+
+	// Description of a polygon, after the header. Offsets are from the beginning of the file.
+	struct Entry {
+		uint64_t name_offset, name_length;
+		uint64_t vertices_offset, n_vertices;	// Coordinates are stored as x0 y0 x1 y1 ...
+		double r, g, b;
+	};
+
+	// Mapped file and its length.
+	const char* data;
+	size_t length;
+
+	// Returns the description of the i-th polygon.
+	const Entry& entry (int i) const;
+
+	// A mapping cannot be copied.
+	Snapshot (const Snapshot&);
+	Snapshot& operator= (const Snapshot&);
+
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "SvgWriter.h"
+
+#include <cmath>
+
+using namespace std;
+
+
+/** Size (in bytes) of the buffer of the file of an SVG drawing. */
+static const int SVG_BUFFER = 1 << 20;
+
+/** Tells whether a file name ends in .svg. */
+bool SvgWriter::is_svg (const string& path) {
+	return path.size() >= 4 and path.compare(path.size() - 4, 4, ".svg") == 0;
+}
+
+/** Constructor. The drawing is empty and no file is open. */
+SvgWriter::SvgWriter ()
+:	f(nullptr),
+	x_min(INFINITY), x_max(-INFINITY),
+	y_min(INFINITY), y_max(-INFINITY),
+	decimals(0),
+	unit(1)
+{	}
+
+/** Destructor. Closes the file if it is still open. */
+SvgWriter::~SvgWriter () {
+	if (f != nullptr) fclose(f);
+}
+
+/** Enlarges the drawing so that it contains the polygon (with its transform applied). */
+void SvgWriter::fit (const ConvexPolygon& cpol) {
+	for (const Point& vertex : cpol.vertices()) {
+		Point p = cpol.apply(vertex);
+		x_min = min(x_min, p.X()); x_max = max(x_max, p.X());
+		y_min = min(y_min, p.Y()); y_max = max(y_max, p.Y());
+	}
+}
+
+/** Creates the file and writes the beginning of the drawing: the view box covers the
+ *  polygons fitted and a margin around them, and the y axis is flipped so that it points
+ *  up, as in the PNG drawings. Coordinates are written up to a billionth of the size of
+ *  the drawing, so no precision is lost by scaling them. Returns false if the file cannot
+ *  be created.
+ */
+bool SvgWriter::open (const char* path) {
+	f = fopen(path, "w");
+	if (f == nullptr) return false;
+	setvbuf(f, nullptr, _IOFBF, SVG_BUFFER);
+
+	if (x_min > x_max) x_min = x_max = y_min = y_max = 0;	// No polygons
+	double width = x_max - x_min, height = y_max - y_min;
+	double side = max(width, height);
+	if (not (side > 0)) side = 1;	// A single point, or no polygons
+	double margin = side/100;
+	decimals = max(0, min(15, int(ceil(9 - log10(side)))));
+	unit = pow(10, decimals);
+
+	s = "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"500\" height=\"500\" viewBox=\"";
+	append_number(x_min - margin); s += ' ';
+	append_number(-y_max - margin); s += ' ';
+	append_number(width + 2*margin); s += ' ';
+	append_number(height + 2*margin);
+	s += "\">\n<g fill=\"none\" stroke-width=\"";
+	append_number((side + 2*margin)/500);	// One pixel of a 500x500 image
+	s += "\">\n";
+	fwrite(s.data(), 1, s.size(), f);
+	return true;
+}
+
+/** Writes a polygon element with its color. It goes to the buffer of the file as soon
+ *  as it is formatted, so the memory used does not depend on the number of polygons.
+ */
+void SvgWriter::write (const ConvexPolygon& cpol) {
+	if (cpol.vertices().empty()) return;
+	double R, G, B;
+	cpol.color(R, G, B);
+	char color[64];
+	s.assign(color, snprintf(color, sizeof color, "<polygon stroke=\"rgb(%d,%d,%d)\" points=\"",
+							 int(lround(255*R)), int(lround(255*G)), int(lround(255*B))));
+	for (const Point& vertex : cpol.vertices()) {
+		Point p = cpol.apply(vertex);
+		append_number(p.X()); s += ',';
+		append_number(-p.Y()); s += ' ';
+	}
+	s.back() = '"';
+	s += "/>\n";
+	fwrite(s.data(), 1, s.size(), f);
+}
+
+/** Ends the drawing and closes the file. Returns false if something could not be written. */
+bool SvgWriter::close () {
+	fputs("</g>\n</svg>\n", f);
+	bool written = not ferror(f);
+	written = fclose(f) == 0 and written;
+	f = nullptr;
+	return written;
+}
+
+/** Appends v to the text with the number of decimals of the drawing, without trailing
+ *  zeros. Values too large to be rounded in a 64-bit integer use snprintf.
+ */
+void SvgWriter::append_number (double v) {
+	double scaled = v*unit;
+	if (not (fabs(scaled) < 9e15)) {
+		char number[32];
+		s.append(number, snprintf(number, sizeof number, "%.17g", v));
+		return;
+	}
+	long long q = llabs(llround(scaled));
+	long long one = llround(unit);
+	if (v < 0 and q > 0) s += '-';
+	char digits[40];
+	int n = 0;
+	long long fraction = q%one;
+	if (fraction > 0) {
+		int i = decimals;
+		for (; fraction%10 == 0; fraction /= 10) --i;	// Trailing zeros
+		for (; i>0; --i, fraction /= 10) digits[n++] = '0' + fraction%10;
+		digits[n++] = '.';
+	}
+	long long whole = q/one;
+	do digits[n++] = '0' + whole%10; while ((whole /= 10) > 0);
+	while (n > 0) s += digits[--n];
+}
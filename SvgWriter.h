@@ -0,0 +1,65 @@
+#ifndef SvgWriter_h
+#define SvgWriter_h
+
+#include <string>
+#include <cstdio>
+#include "ConvexPolygon.h"
+
+using namespace std;
+
+/* 	This class writes polygons to an SVG file one by one, so that drawing a set of
+ *	polygons does not need to keep them all. The polygons are given twice: first to
+ *	fit, which finds the size of the drawing, and then, once the file is open, to write.
+ */
+
+class SvgWriter {
+
+public:
+
+	// Tells whether a file name ends in .svg.
+	static bool is_svg (const string& path);
+
+	// Constructor. The drawing is empty and no file is open.
+	SvgWriter ();
+
+	// Destructor. Closes the file if it is still open.
+	~SvgWriter ();
+
+	// Enlarges the drawing so that it contains the polygon (with its transform applied).
+	void fit (const ConvexPolygon& cpol);
+
+	// Creates the file and writes the beginning of the drawing. Returns false if the file
+	// cannot be created.
+	bool open (const char* path);
+
+	// Writes a polygon with its color. Empty polygons are skipped.
+	void write (const ConvexPolygon& cpol);
+
+	// Ends the drawing and closes the file. Returns false if something could not be written.
+	bool close ();
+
+private:
+
+	// Open file, or null.
+	FILE* f;
+
+	// Smallest rectangle containing the polygons fitted.
+	double x_min, x_max, y_min, y_max;
+
+	// Number of decimals of the coordinates written, and 10 to that number.
+	int decimals;
+	double unit;
+
+	// Text of the element being written.
+	string s;
+
+	// Appends v to the text with the number of decimals of the drawing.
+	void append_number (double v);
+
+	// A file cannot be copied.
+	SvgWriter (const SvgWriter&);
+	SvgWriter& operator= (const SvgWriter&);
+
+};
+
+#endif
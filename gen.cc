@@ -0,0 +1,157 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <random>
+
+using namespace std;
+
+/*	Generator of command scripts for the polygon calculator, used to measure it with
+ *	large workloads (see replay). The same options and seed always give the same script.
+ *
+ *	Usage: gen [-n commands] [-p polygons] [-v min_vertices:max_vertices] [-s seed]
+ *	           [-m polygon=20,union=15,intersection=15,inside=25,area=20,draw=5]
+ */
+
+// Commands that can be generated, in the order they are chosen.
+const vector<string> COMMANDS = {"polygon", "union", "intersection", "inside", "area", "draw"};
+
+// Options of the generator.
+struct Options {
+	long n_commands = 10000;			// Number of commands after the polygons are defined
+	int n_polygons = 100;				// Number of names used
+	int min_vertices = 3, max_vertices = 20;	// Points given to each polygon command
+	unsigned long seed = 1;
+	map<string, double> mix = {{"polygon", 20}, {"union", 15}, {"intersection", 15},
+							   {"inside", 25}, {"area", 20}, {"draw", 5}};
+};
+
+// Random numbers. The distributions of the standard library may differ between
+// implementations, so they are computed from the generator directly.
+struct Random {
+	mt19937 engine;
+
+	Random (unsigned long seed) : engine(seed) {}
+
+	// Returns a number in [0, 1).
+	double real () { return engine()/4294967296.0; }
+
+	// Returns a number in [a, b].
+	int integer (int a, int b) { return a + int(real()*(b - a + 1)); }
+};
+
+// Returns the name of the i-th polygon.
+string name (int i) {
+	return "p" + to_string(i);
+}
+
+// Writes a polygon command with random points around a random center, so that
+// polygons often overlap.
+void polygon (const string& name, const Options& options, Random& random, ostream& out) {
+	int n = random.integer(options.min_vertices, options.max_vertices);
+	double cx = 100*random.real(), cy = 100*random.real();
+	double radius = 5 + 20*random.real();
+	out << "polygon " << name;
+	for (int i=0; i<n; ++i) {
+		double angle = 2*M_PI*random.real();
+		double r = radius*sqrt(random.real());
+		out << ' ' << cx + r*cos(angle) << ' ' << cy + r*sin(angle);
+	}
+	out << '\n';
+}
+
+// Writes a command of the given kind over random polygons. The random names are drawn
+// before writing, as the order in which the operands of << are evaluated is unspecified.
+void command (const string& kind, const Options& options, Random& random, ostream& out) {
+	string a = name(random.integer(0, options.n_polygons - 1));
+	if (kind == "polygon") {
+		polygon(a, options, random, out);
+		return;
+	}
+	string b = name(random.integer(0, options.n_polygons - 1));
+	string c = name(random.integer(0, options.n_polygons - 1));
+	if (kind == "union" or kind == "intersection") out << kind << ' ' << a << ' ' << b << ' ' << c << '\n';
+	else if (kind == "inside") out << "inside " << a << ' ' << b << '\n';
+	else if (kind == "area") out << "area " << a << '\n';
+	else out << "draw gen_" << random.integer(0, 3) << ".png " << a << ' ' << b << ' ' << c << '\n';
+}
+
+// Reads the mix of commands ("polygon=20,area=10,..."). Returns false if it is not valid.
+bool read_mix (const string& text, map<string, double>& mix) {
+	map<string, double> read;
+	istringstream iss(text);
+	string item;
+	while (getline(iss, item, ',')) {
+		size_t eq = item.find('=');
+		if (eq == string::npos) return false;
+		string kind = item.substr(0, eq);
+		char* end;
+		double weight = strtod(item.c_str() + eq + 1, &end);
+		if (*end != '\0' or weight < 0 or mix.count(kind) == 0) return false;
+		read[kind] = weight;
+	}
+	double total = 0;
+	for (const auto& elem : read) total += elem.second;
+	if (total <= 0) return false;
+	for (auto& elem : mix) elem.second = read.count(elem.first) ? read[elem.first] : 0;
+	return true;
+}
+
+int main (int argc, char* argv[]) {
+	Options options;
+	for (int i=1; i<argc; ++i) {
+		string arg = argv[i];
+		bool valid = i + 1 < argc;
+		if (valid) {
+			string value = argv[++i];
+			if (arg == "-n") options.n_commands = atol(value.c_str());
+			else if (arg == "-p") options.n_polygons = atoi(value.c_str());
+			else if (arg == "-s") options.seed = strtoul(value.c_str(), nullptr, 10);
+			else if (arg == "-m") valid = read_mix(value, options.mix);
+			else if (arg == "-v") {
+				valid = sscanf(value.c_str(), "%d:%d", &options.min_vertices, &options.max_vertices) == 2;
+			}
+			else valid = false;
+		}
+		valid = valid and options.n_commands >= 0 and options.n_polygons > 0
+				and options.min_vertices >= 1 and options.min_vertices <= options.max_vertices;
+		if (not valid) {
+			cerr << "usage: gen [-n commands] [-p polygons] [-v min_vertices:max_vertices] [-s seed]"
+				 << " [-m polygon=20,union=15,intersection=15,inside=25,area=20,draw=5]" << endl;
+			return 1;
+		}
+	}
+
+	Random random(options.seed);
+	ostringstream out;
+	out.setf(ios::fixed);
+	out.precision(3);
+
+	// All names are defined first, so that every command refers to existing polygons.
+	for (int i=0; i<options.n_polygons; ++i) polygon(name(i), options, random, out);
+
+	double total = 0;
+	for (const string& kind : COMMANDS) total += options.mix[kind];
+	for (long c=0; c<options.n_commands; ++c) {
+		double x = total*random.real();
+		string kind;
+		for (const string& k : COMMANDS) {
+			if (options.mix[k] > 0) kind = k;	// The last one if rounding leaves x too large
+			if (x < options.mix[k]) break;
+			x -= options.mix[k];
+		}
+		command(kind, options, random, out);
+
+		// Written in blocks to keep the memory bounded.
+		if (out.tellp() > (1 << 20)) {
+			cout << out.str();
+			out.str("");
+		}
+	}
+	cout << out.str();
+}
@@ -3,21 +3,157 @@
 #include <string>
 #include <map>
 #include <fstream>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <set>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 
 #include "ConvexPolygon.h"
+#include "ResultCache.h"
+#include "Snapshot.h"
+#include "PointFile.h"
+#include "SvgWriter.h"
 
 using namespace std;
 
-void comment() {
-	cout << '#' << endl;
+/*	Expression graph over the named polygons.
+ *	Every name is bound to a node, which is either a known polygon, a polygon still in a
+ *	snapshot file or a pending union or intersection of two or more other nodes. Pending nodes are only computed when a command needs
+ *	their vertices, and the result is kept in the node. A node never changes once built:
+ *	redefining a polygon binds its name to a new node, so the expressions that used the
+ *	old one are not affected.
+ */
+struct Expression {
+	char op;						// '=' for a known polygon, 's' for a snapshot, '+' for a union, '*' for an intersection
+	vector<shared_ptr<Expression>> operands;	// Empty once the node has been evaluated
+	ConvexPolygon value;			// Only meaningful once evaluated
+	once_flag evaluated;			// Makes concurrent commands compute the value only once
+	int depth;						// Longest chain of pending nodes below this one
+	unsigned long id;				// Unique identifier of the node
+	shared_ptr<const Snapshot> snapshot;	// Mapped file of a polygon in a snapshot
+	int entry;						// Position of the polygon in the snapshot
+};
+
+// Every command that changes a polygon binds its name to a new node, so the identifier
+// of a node also works as the version of the polygon when caching results.
+
+typedef shared_ptr<Expression> Node;
+
+// Pending expressions deeper than this are computed right away to keep the recursion bounded.
+const int MAX_PENDING_DEPTH = 1000;
+
+// Number of nodes created so far, used to give them their identifiers.
+unsigned long created_nodes = 0;
+
+// Pending nodes by operation and identifiers of the operands (as their cache key), so that
+// repeated subexpressions share their result.
+map<string, weak_ptr<Expression>> subexpressions;
+
+// Results of the queries, by query and identifiers of the nodes they were computed from.
+ResultCache cache;
+
+// Returns the key of a query about some nodes in the cache.
+string cache_key(const string& query, const vector<Node>& nodes) {
+	string key = query;
+	for (const Node& node : nodes) key += ' ' + to_string(node->id);
+	return key;
+}
+
+// Returns a node holding an already known polygon.
+Node leaf(const ConvexPolygon& polyg) {
+	Node node = make_shared<Expression>();
+	node->op = '=';
+	node->value = polyg;
+	call_once(node->evaluated, []() {}); // Nothing to compute
+	node->depth = 0;
+	node->id = ++created_nodes;
+	return node;
+}
+
+// Computes the polygon of a node, if it was not done before, and returns it.
+const ConvexPolygon& evaluate(const Node& node) {
+	call_once(node->evaluated, [&node]() {
+		if (node->op == 's') {
+			node->value = node->snapshot->polygon(node->entry);
+			node->snapshot.reset(); // The vertices were copied, so the file may now be unmapped
+			return;
+		}
+		// Repeated subexpressions already share this node (see pending), so the result is not cached.
+		node->value = evaluate(node->operands[0]);
+		if (node->op == '+') {
+			for (int i=1; i<int(node->operands.size()); ++i) node->value += evaluate(node->operands[i]);
+		}
+		else {
+			vector<ConvexPolygon> cpols;
+			for (const Node& operand : node->operands) cpols.push_back(evaluate(operand));
+			node->value.intersection(cpols);
+		}
+		node->depth = 0;
+		node->operands.clear(); // The operands may now be freed
+	});
+	return node->value;
+}
+
+// Returns a node for the i-th polygon of a snapshot, which is read when it is needed.
+Node restored(const shared_ptr<const Snapshot>& snapshot, int i) {
+	Node node = make_shared<Expression>();
+	node->op = 's';
+	node->snapshot = snapshot;
+	node->entry = i;
+	node->depth = 0;
+	node->id = ++created_nodes;
+	return node;
+}
+
+// Returns a pending node for the union ('+') or intersection ('*') of the operands.
+// The result keeps the color of the first operand.
+Node pending(char op, const vector<Node>& operands) {
+	string key = cache_key(string(1, op), operands);
+	Node node = subexpressions[key].lock();
+	if (node) return node;
+
+	// Forgetting the subexpressions that no longer exist once the table has doubled its size.
+	static size_t prune_size = 1024;
+	if (subexpressions.size() > prune_size) {
+		for (auto it = subexpressions.begin(); it != subexpressions.end(); ) {
+			if (it->second.expired()) it = subexpressions.erase(it);
+			else ++it;
+		}
+		prune_size = max(prune_size, 2*subexpressions.size());
+	}
+
+	node = make_shared<Expression>();
+	node->op = op;
+	node->operands = operands;
+	node->depth = 0;
+	for (const Node& operand : operands) node->depth = max(node->depth, operand->depth + 1);
+	node->id = ++created_nodes;
+	if (node->depth > MAX_PENDING_DEPTH) evaluate(node);
+	subexpressions[key] = node;
+	return node;
+}
+
+void comment(istream& in, ostream& out) {
+	out << '#' << endl;
 	string s;
-	getline(cin, s);
+	getline(in, s);
 }
 
 // To define a polygon
-void polygon(map<string, ConvexPolygon>& polygons) {
+void polygon(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 
 	string name;
@@ -28,120 +164,185 @@ void polygon(map<string, ConvexPolygon>& polygons) {
 
 		// Error handling
 		if (!(iss >> x >> y)) {
-			cout << "error: command with wrong number or type of arguments" << endl;
+			out << "error: command with wrong number or type of arguments" << endl;
 			return;
 		}
 		v.push_back(Point(x,y));
 	}
 	ConvexPolygon polyg(v);
-	polygons[name] = polyg;
-	cout << "ok" << endl;
+	polygons[name] = leaf(polyg);
+	out << "ok" << endl;
 }
 
 // Prints a polygon in clockwise order
-void print(map<string, ConvexPolygon>& polygons) {
+void print(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name;
 	iss >> name;
 
 	// Error handling
 	if (polygons.count(name) == 0) {
-		cout << "error: undefined polygon identifier" << endl;
+		out << "error: undefined polygon identifier" << endl;
 		return;
 	}
 
-	cout << name;
-	vector<Point> vert = polygons[name].vertices();
+	out << name;
+	ConvexPolygon polyg = evaluate(polygons.at(name));
+	vector<Point> vert = polyg.materialize().vertices();
 
-	// Printing in clockwise order
-	cout << ' ' << vert[0].X() << ' ' << vert[0].Y();
+	// Printing in clockwise order (an empty intersection has no vertices)
+	if (not vert.empty()) out << ' ' << vert[0].X() << ' ' << vert[0].Y();
 	reverse(vert.begin(), vert.end());
-	vert.pop_back();
+	if (not vert.empty()) vert.pop_back();
 	for (const Point& p : vert) {
-		cout << ' ' << p.X() << ' ' << p.Y();
+		out << ' ' << p.X() << ' ' << p.Y();
 	}
-	cout << endl;
+	out << endl;
 }
 
 // Prints the area of the polygon
-void area(map<string, ConvexPolygon>& polygons) {
+void area(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name;
 	iss >> name;
 
 	// Error handling
 	if (polygons.count(name) == 0) {
-		cout << "error: undefined polygon identifier" << endl;
+		out << "error: undefined polygon identifier" << endl;
 		return;
 	}
 
-	cout << polygons[name].area() << endl;
+	string key = cache_key("area", {polygons.at(name)});
+	double a;
+	if (not cache.find(key, a)) {
+		a = evaluate(polygons.at(name)).area();
+		cache.insert(key, a);
+	}
+	out << a << endl;
 }
 
 // Prints the perimeter
-void perimeter(map<string, ConvexPolygon>& polygons) {
+void perimeter(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name;
 	iss >> name;
 
 	// Error handling
 	if (polygons.count(name) == 0) {
-		cout << "error: undefined polygon identifier" << endl;
+		out << "error: undefined polygon identifier" << endl;
 		return;
 	}
 	
-	cout << polygons[name].perimeter() << endl;
+	string key = cache_key("perimeter", {polygons.at(name)});
+	double p;
+	if (not cache.find(key, p)) {
+		p = evaluate(polygons.at(name)).perimeter();
+		cache.insert(key, p);
+	}
+	out << p << endl;
 }
 
 // Prints the number of vertices of the polygon
-void n_vertices(map<string, ConvexPolygon>& polygons) {
+void n_vertices(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name;
 	iss >> name;
 
 	// Error handling
 	if (polygons.count(name) == 0) {
-		cout << "error: undefined polygon identifier" << endl;
+		out << "error: undefined polygon identifier" << endl;
 		return;
 	}
 	
-	cout << polygons[name].vertices().size() << endl;
+	out << evaluate(polygons.at(name)).vertices().size() << endl;
 }
 
 // Prints the centroid
-void centroid(map<string, ConvexPolygon>& polygons) {
+void centroid(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name;
 	iss >> name;
 
 	// Error handling
 	if (polygons.count(name) == 0) {
-		cout << "error: undefined polygon identifier" << endl;
+		out << "error: undefined polygon identifier" << endl;
 		return;
 	}
 	
-	cout << polygons[name].centroid().X() << " " << polygons[name].centroid().Y() << endl;
+	Point c = evaluate(polygons.at(name)).centroid();
+	out << c.X() << " " << c.Y() << endl;
+}
+
+// Least number of vertices given to each thread of metrics.
+const size_t MIN_VERTICES_PER_THREAD = 1 << 16;
+
+// Prints the area, perimeter and centroid of the given polygons (or all of them if none
+// is given), one polygon per line. The polygons are split among several threads.
+void metrics(map<string, Node>& polygons, istream& in, ostream& out) {
+	string s;
+	getline(in, s);
+	istringstream iss(s);
+	vector<string> names;
+	string name;
+	while (iss >> name) {
+
+		// Error handling
+		if (polygons.count(name) == 0) {
+			out << "error: undefined polygon identifier" << endl;
+			return;
+		}
+
+		names.push_back(name);
+	}
+	if (names.empty()) for (const auto& elem : polygons) names.push_back(elem.first);
+
+	int k = names.size();
+	vector<const ConvexPolygon*> cpols(k);
+	size_t n_vertices = 0;
+	for (int i=0; i<k; ++i) {
+		cpols[i] = &evaluate(polygons.at(names[i]));
+		n_vertices += cpols[i]->vertices().size();
+	}
+
+	// Small polygons are measured without threads, as starting them would take longer.
+	vector<double> areas(k), perimeters(k);
+	vector<Point> centroids(k);
+	auto measure = [&](int first, int step) {
+		for (int i=first; i<k; i+=step) cpols[i]->metrics(areas[i], perimeters[i], centroids[i]);
+	};
+	int n_threads = min(k, int(min(size_t(max(1u, thread::hardware_concurrency())), n_vertices/MIN_VERTICES_PER_THREAD)));
+	if (n_threads <= 1) measure(0, 1);
+	else {
+		vector<thread> threads;
+		for (int t=0; t<n_threads; ++t) threads.push_back(thread(measure, t, n_threads));
+		for (thread& th : threads) th.join();
+	}
+
+	for (int i=0; i<k; ++i) {
+		out << names[i] << ' ' << areas[i] << ' ' << perimeters[i] << ' '
+			<< centroids[i].X() << ' ' << centroids[i].Y() << endl;
+	}
 }
 
 // Lists all polygons
-void list(const map<string, ConvexPolygon>& polygons) {
+void list(const map<string, Node>& polygons, ostream& out) {
 	bool first = true;
 	for (const auto& elem : polygons) {
-		if (not first) cout << ' ';
+		if (not first) out << ' ';
 		else first = false;
-		cout << elem.first;
+		out << elem.first;
 	}
-	cout << endl;
+	out << endl;
 }
 
 // Returns a string with the output that would be printed when print is called.
@@ -151,12 +352,12 @@ string vert_output(const string& name, const ConvexPolygon& polyg) {
 	oss.precision(3);
 
 	oss << name;
-	vector<Point> vert = polyg.vertices();
+	vector<Point> vert = polyg.applied().vertices();
 
-	// Printing in clockwise order
-	oss << ' ' << vert[0].X() << ' ' << vert[0].Y();
+	// Printing in clockwise order (an empty intersection has no vertices)
+	if (not vert.empty()) oss << ' ' << vert[0].X() << ' ' << vert[0].Y();
 	reverse(vert.begin(), vert.end());
-	vert.pop_back();
+	if (not vert.empty()) vert.pop_back();
 	for (const Point& p : vert) {
 		oss << ' ' << p.X() << ' ' << p.Y();
 	}
@@ -166,11 +367,11 @@ string vert_output(const string& name, const ConvexPolygon& polyg) {
 }
 
 // Saves the polygons in a file
-void save(map<string, ConvexPolygon>& polygons) {
+void save(map<string, Node>& polygons, istream& in, ostream& out) {
 	string filename;
-	cin >> filename;
+	in >> filename;
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name;
 	ofstream f(filename);
@@ -178,21 +379,33 @@ void save(map<string, ConvexPolygon>& polygons) {
 
 		// Error handling
 		if (polygons.count(name) == 0) {
-			cout << "error: undefined polygon identifier" << endl;
+			out << "error: undefined polygon identifier" << endl;
 			return;
 		}
 		
-		f << vert_output(name, polygons[name]);
+		f << vert_output(name, evaluate(polygons.at(name)));
 	}
 	f.close();
-	cout << "ok" << endl;
+	out << "ok" << endl;
 }
 
 // Loads the polygons from a file. In case they are not sorted,
 // the ConvexPolygon constructor is set to false.
-void load(map<string, ConvexPolygon>& polygons) {
+// If a tolerance is given after the file name, the polygons are simplified with it.
+void load(map<string, Node>& polygons, istream& in, ostream& out) {
 	string filename;
-	cin >> filename;
+	in >> filename;
+	string s;
+	getline(in, s);
+	istringstream args(s);
+	bool simplified = args.rdbuf()->in_avail();
+	double tolerance = 0;
+
+	// Error handling (the same tolerances as in simplify)
+	if (simplified and (!(args >> tolerance) or tolerance < 0)) {
+		out << "error: command with wrong number or type of arguments" << endl;
+		return;
+	}
 	ifstream f(filename);
 	string gl;
 	while (getline(f, gl)) {
@@ -205,28 +418,68 @@ void load(map<string, ConvexPolygon>& polygons) {
 
 			// Error handling
 			if (!(iss >> x >> y)) {
-				cout << "error: wrong format" << endl;
+				out << "error: wrong format" << endl;
 				return;
 			}
 
 			points.push_back(Point(x, y));
 		}
-		polygons[name] = ConvexPolygon(points, false);
+		ConvexPolygon polyg(points, false);
+		if (simplified) polyg.simplify(tolerance);
+		polygons[name] = leaf(polyg);
+	}
+	out << "ok" << endl;
+}
+
+// Writes all polygons (names, vertices and colors) to a snapshot file.
+void snapshot(map<string, Node>& polygons, istream& in, ostream& out) {
+	string filename;
+	in >> filename;
+	string s;
+	getline(in, s);
+	vector<ConvexPolygon> applied;
+	for (const auto& elem : polygons) applied.push_back(evaluate(elem.second).applied());
+	vector<pair<string, const ConvexPolygon*>> named;
+	int i = 0;
+	for (const auto& elem : polygons) named.push_back({elem.first, &applied[i++]});
+	if (not Snapshot::write(filename, named)) {
+		out << "error: cannot write file" << endl;
+		return;
+	}
+	out << "ok" << endl;
+}
+
+// Replaces all polygons with the ones in a snapshot file. The file is mapped into
+// memory and each polygon is only read from it when some command needs it.
+void restore(map<string, Node>& polygons, istream& in, ostream& out) {
+	string filename;
+	in >> filename;
+	string s;
+	getline(in, s);
+	shared_ptr<const Snapshot> snap = make_shared<Snapshot>(filename);
+
+	// Error handling
+	if (not snap->is_open()) {
+		out << "error: wrong format" << endl;
+		return;
 	}
-	cout << "ok" << endl;
+
+	polygons.clear();
+	for (int i=0; i<snap->size(); ++i) polygons[snap->name(i)] = restored(snap, i);
+	out << "ok" << endl;
 }
 
 // Sets the color of the polygon
-void setcol(map<string, ConvexPolygon>& polygons) {
+void setcol(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name;
 	iss >> name;
 	
 	// Error handling
 	if (polygons.count(name) == 0) {
-		cout << "error: undefined polygon identifier" << endl;
+		out << "error: undefined polygon identifier" << endl;
 		return;
 	}
 	
@@ -234,50 +487,70 @@ void setcol(map<string, ConvexPolygon>& polygons) {
 
 	// Error handling
 	if (!(iss >> r >> g >> b)) {
-		cout << "error: command with wrong number or type of arguments" << endl;
+		out << "error: command with wrong number or type of arguments" << endl;
 		return;
 	}
 
-	polygons[name].set_color(r, g, b);
-	cout << "ok" << endl;
+	// The node may be an operand of pending expressions, so it is replaced instead of modified.
+	ConvexPolygon polyg = evaluate(polygons.at(name));
+	polyg.set_color(r, g, b);
+	polygons[name] = leaf(polyg);
+	out << "ok" << endl;
 }
 
 // Draws the polygons given
-void draw(map<string, ConvexPolygon>& polygons) {
+void draw(map<string, Node>& polygons, istream& in, ostream& out) {
 	string img_name;
-	cin >> img_name;
+	in >> img_name;
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
-	vector<ConvexPolygon> pols;
+	vector<string> names;
 	string name;
 	while (iss >> name) {
 
 		// Error handling
 		if (polygons.count(name) == 0) {
-			cout << "error: undefined polygon identifier" << endl;
+			out << "error: undefined polygon identifier" << endl;
 			return;
 		}
 		
-		pols.push_back(polygons[name]);
+		names.push_back(name);
 	}
-	polygons[name].draw(img_name.c_str(), pols);
-	cout << "ok" << endl;
+
+	// SVG drawings are streamed: the polygons are fitted first, and then written one by one.
+	bool written;
+	if (SvgWriter::is_svg(img_name)) {
+		SvgWriter svg;
+		for (const string& name : names) svg.fit(evaluate(polygons.at(name)));
+		written = svg.open(img_name.c_str());
+		if (written) {
+			for (const string& name : names) svg.write(evaluate(polygons.at(name)));
+			written = svg.close();
+		}
+	}
+	else {
+		vector<ConvexPolygon> pols;
+		for (const string& name : names) pols.push_back(evaluate(polygons.at(name)));
+		written = ConvexPolygon().draw(img_name.c_str(), pols);
+	}
+	if (not written) out << "error: cannot write file" << endl;
+	else out << "ok" << endl;
 }
 
-// Computes the intersection of the two polygons given as input.
+// Computes the intersection of the polygons given as input.
 // If the input consists of 2 polygons the first is redefined as the intersection.
-// If the input are 3 polygons, the first is redefined as the intersection of the other ones.
-void intersection(map<string, ConvexPolygon>& polygons) {
+// If the input are 3 or more polygons, the first is redefined as the intersection of the other ones.
+void intersection(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name1;
 	iss >> name1;
 
 	// Error handling
 	if (polygons.count(name1) == 0) {
-		cout << "error: undefined polygon identifier" << endl;
+		out << "error: undefined polygon identifier" << endl;
 		return;
 	}
 	vector<string> names;
@@ -286,32 +559,45 @@ void intersection(map<string, ConvexPolygon>& polygons) {
 
 		// Error handling
 		if (polygons.count(s) == 0) {
-			cout << "error: undefined polygon identifier" << endl;
+			out << "error: undefined polygon identifier" << endl;
 			return;
 		}
 
 		names.push_back(s); ++i;
 	}
-	if (i == 1) polygons[name1] *= polygons[names[0]];
-	else polygons[name1] = polygons[names[0]] * polygons[names[1]];
-	cout << "ok" << endl;
+	// Error handling
+	if (i == 0) {
+		out << "error: command with wrong number or type of arguments" << endl;
+		return;
+	}
+
+	// The intersection is only computed when needed. As in operator*, the result
+	// keeps the color of the last polygon.
+	vector<Node> operands;
+	if (i == 1) operands = {polygons.at(name1), polygons.at(names[0])};
+	else {
+		operands.push_back(polygons.at(names[i-1]));
+		for (int j=0; j<i-1; ++j) operands.push_back(polygons.at(names[j]));
+	}
+	polygons[name1] = pending('*', operands);
+	out << "ok" << endl;
 }
 
 // Computes the convex union of the two polygons given as input.
 // If the input consists of 2 polygons the first is redefined as the convex union.
 // If the input are 3 polygons, the first is redefined as the convex union of the other ones.
-void p_union(map<string, ConvexPolygon>& polygons) {
+void p_union(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string result_name;
 	iss >> result_name;
 
 	// Error handling
 	if (polygons.count(result_name) == 0) {
-		cout << "error: undefined polygon identifier" << endl;
+		out << "error: undefined polygon identifier" << endl;
 		string s;
-		getline(cin, s);
+		getline(in, s);
 		return;
 	}
 	
@@ -321,105 +607,685 @@ void p_union(map<string, ConvexPolygon>& polygons) {
 
 		// Error handling
 		if (polygons.count(s) == 0) {
-			cout << "error: undefined polygon identifier" << endl;
+			out << "error: undefined polygon identifier" << endl;
 			return;
 		}
 
 		names.push_back(s); ++i;
 	}
-	if (i == 1) polygons[result_name] += polygons[names[0]];
-	else polygons[result_name] = polygons[names[0]] + polygons[names[1]];
-	cout << "ok" << endl;
+	// The union is only computed when needed. As in operator+, b+c is evaluated as c += b.
+	if (i == 1) polygons[result_name] = pending('+', {polygons.at(result_name), polygons.at(names[0])});
+	else polygons[result_name] = pending('+', {polygons.at(names[1]), polygons.at(names[0])});
+	out << "ok" << endl;
 }
 
 // Prints if the first polygon is inside the second one
-void inside(map<string, ConvexPolygon>& polygons) {
+void inside(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name1, name2;
 	iss >> name1 >> name2;
 
 	// Error handling
 	if (polygons.count(name1) == 0 or polygons.count(name2) == 0) {
-		cout << "error: undefined polygon identifier" << endl;
+		out << "error: undefined polygon identifier" << endl;
 		return;
 	}
 	
-	cout << (polygons[name1].is_inside(polygons[name2]) ? "yes" : "no") << endl;
+	string key = cache_key("inside", {polygons.at(name1), polygons.at(name2)});
+	double is_inside;
+	if (not cache.find(key, is_inside)) {
+		is_inside = evaluate(polygons.at(name1)).is_inside(evaluate(polygons.at(name2)));
+		cache.insert(key, is_inside);
+	}
+	out << (is_inside ? "yes" : "no") << endl;
 }
 
 // Defines the first polygon as the bounding box of the subsequent ones.
-void bbox(map<string, ConvexPolygon>& polygons) {
+void bbox(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name;
 	iss >> name;
 
 	// Building a vector of all polygons.
-	vector<ConvexPolygon> cpols;
+	vector<Node> nodes;
 	string pol_name;
 	while(iss >> pol_name) {
 
 		// Error handling
 		if (polygons.count(pol_name) == 0) {
-			cout << "error: undefined polygon identifier" << endl;
+			out << "error: undefined polygon identifier" << endl;
 			return;
 		}
 
-		cpols.push_back(polygons[pol_name]);
+		nodes.push_back(polygons.at(pol_name));
+	}
+
+	string key = cache_key("bbox", nodes);
+	ConvexPolygon box;
+	if (not cache.find(key, box)) {
+		vector<ConvexPolygon> cpols;
+		for (const Node& node : nodes) cpols.push_back(evaluate(node));
+		box.bounding_box(cpols);
+		cache.insert(key, box);
 	}
-	polygons[name].bounding_box(cpols);
-	cout << "ok" << endl;
+	polygons[name] = leaf(box);
+	out << "ok" << endl;
+}
+
+// Prints the signed distance (negative inside) from each of the given points to the boundary of
+// the polygon or, if print_nearest is set, the closest point of the boundary to each of them.
+void distance_query(map<string, Node>& polygons, istream& in, ostream& out, bool print_nearest) {
+	string s;
+	getline(in, s);
+	istringstream iss(s);
+	string name;
+	iss >> name;
+
+	// Error handling
+	if (polygons.count(name) == 0) {
+		out << "error: undefined polygon identifier" << endl;
+		return;
+	}
+
+	vector<Point> points;
+	double x, y;
+	while (iss.rdbuf()->in_avail()) { // Istringstream is not empty
+
+		// Error handling
+		if (!(iss >> x >> y)) {
+			out << "error: command with wrong number or type of arguments" << endl;
+			return;
+		}
+		points.push_back(Point(x,y));
+	}
+
+	const ConvexPolygon& polyg = evaluate(polygons.at(name));
+
+	// Error handling
+	if (points.empty() or polyg.vertices().empty()) {
+		out << "error: command with wrong number or type of arguments" << endl;
+		return;
+	}
+
+	vector<double> distances;
+	vector<Point> nearest;
+	polyg.signed_distances(points, distances, nearest);
+	for (int i=0; i<int(points.size()); ++i) {
+		if (i > 0) out << ' ';
+		if (print_nearest) out << nearest[i].X() << ' ' << nearest[i].Y();
+		else out << distances[i];
+	}
+	out << endl;
+}
+
+// Least number of exact overlap checks given to each thread.
+const int MIN_CHECKS_PER_THREAD = 256;
+
+// Prints the pairs of the given polygons (or all of them if none is given) that overlap.
+// Candidate pairs are those with overlapping bounding boxes, found by sorting the boxes by
+// their left side and sweeping them. Candidates are then checked exactly using several threads.
+void overlaps(map<string, Node>& polygons, istream& in, ostream& out) {
+	string s;
+	getline(in, s);
+	istringstream iss(s);
+	vector<string> names;
+	set<string> given;
+	string name;
+	while (iss >> name) {
+
+		// Error handling
+		if (polygons.count(name) == 0) {
+			out << "error: undefined polygon identifier" << endl;
+			return;
+		}
+
+		// A polygon given twice is only checked once (it is not paired with itself).
+		if (given.insert(name).second) names.push_back(name);
+	}
+	if (names.empty()) for (const auto& elem : polygons) names.push_back(elem.first);
+
+	// Bounding boxes of the polygons (empty polygons overlap nothing).
+	int k = names.size();
+	vector<ConvexPolygon> cpols(k);
+	vector<double> x_min(k, INFINITY), x_max(k, -INFINITY), y_min(k, INFINITY), y_max(k, -INFINITY);
+	for (int i=0; i<k; ++i) {
+		cpols[i] = evaluate(polygons.at(names[i]));
+		for (const Point& p : cpols[i].materialize().vertices()) {
+			x_min[i] = min(x_min[i], p.X()); x_max[i] = max(x_max[i], p.X());
+			y_min[i] = min(y_min[i], p.Y()); y_max[i] = max(y_max[i], p.Y());
+		}
+	}
+
+	// Sweep over the boxes sorted by their left side, keeping those that are still open.
+	vector<int> order;
+	for (int i=0; i<k; ++i) if (x_min[i] <= x_max[i]) order.push_back(i);
+	sort(order.begin(), order.end(), [&](int i, int j) { return x_min[i] < x_min[j]; });
+	vector<pair<int, int>> candidates;
+	vector<int> open;
+	for (int i : order) {
+		int kept = 0;
+		for (int j : open) {
+			if (x_max[j] < x_min[i]) continue; // Closed: no later box can reach it
+			open[kept++] = j;
+			if (y_min[i] <= y_max[j] and y_min[j] <= y_max[i]) candidates.push_back({min(i, j), max(i, j)});
+		}
+		open.resize(kept);
+		open.push_back(i);
+	}
+
+	// Exact checks, split among the threads. Few checks are done without threads,
+	// as starting them would take longer than the checks.
+	int n_candidates = candidates.size();
+	vector<char> overlap(n_candidates);
+	auto check = [&](int first, int step) {
+		for (int c=first; c<n_candidates; c+=step) overlap[c] = cpols[candidates[c].first].overlaps(cpols[candidates[c].second]);
+	};
+	int n_threads = min(int(max(1u, thread::hardware_concurrency())), n_candidates/MIN_CHECKS_PER_THREAD);
+	if (n_threads <= 1) check(0, 1);
+	else {
+		vector<thread> threads;
+		for (int t=0; t<n_threads; ++t) threads.push_back(thread(check, t, n_threads));
+		for (thread& th : threads) th.join();
+	}
+
+	vector<pair<int, int>> pairs;
+	for (int c=0; c<int(candidates.size()); ++c) if (overlap[c]) pairs.push_back(candidates[c]);
+	sort(pairs.begin(), pairs.end());
+	bool first = true;
+	for (const auto& pr : pairs) {
+		if (not first) out << ' ';
+		else first = false;
+		out << names[pr.first] << ',' << names[pr.second];
+	}
+	out << endl;
+}
+
+// Bytes of counts kept by each thread of "join points" before writing them.
+const size_t JOIN_BUFFER_SIZE = 1 << 20;
+
+// Least number of bytes of the file of points read by each thread of join.
+const size_t MIN_BYTES_PER_THREAD = 1 << 18;
+
+// Counts the points of a file that are inside each of the given polygons (or all of them if none
+// is given) with "join polygons file", or writes how many of these polygons contain each point of
+// the file with "join points file output". Candidates are found with a grid over the bounding
+// boxes of the polygons and checked exactly, splitting the file among several threads.
+void join(map<string, Node>& polygons, istream& in, ostream& out) {
+	string s;
+	getline(in, s);
+	istringstream iss(s);
+	string mode, filename, output;
+	iss >> mode >> filename;
+
+	// Error handling
+	if ((mode != "polygons" and mode != "points") or filename.empty() or (mode == "points" and not (iss >> output))) {
+		out << "error: command with wrong number or type of arguments" << endl;
+		return;
+	}
+
+	vector<string> names;
+	string name;
+	while (iss >> name) {
+
+		// Error handling
+		if (polygons.count(name) == 0) {
+			out << "error: undefined polygon identifier" << endl;
+			return;
+		}
+
+		names.push_back(name);
+	}
+	if (names.empty()) for (const auto& elem : polygons) names.push_back(elem.first);
+
+	PointFile file(filename);
+
+	// Error handling
+	if (not file.is_open()) {
+		out << "error: cannot read file" << endl;
+		return;
+	}
+
+	// Bounding boxes of the polygons (empty polygons contain nothing).
+	int k = names.size();
+	vector<ConvexPolygon> cpols(k);
+	vector<Point> LL(k), UR(k);
+	vector<bool> empty(k, true);
+	double x_min = INFINITY, x_max = -INFINITY, y_min = INFINITY, y_max = -INFINITY;
+	for (int i=0; i<k; ++i) {
+		cpols[i] = evaluate(polygons.at(names[i]));
+		ConvexPolygon box;
+		box.bounding_box({cpols[i]}, LL[i], UR[i]);
+		if (box.vertices().empty()) continue;
+		empty[i] = false;
+		x_min = min(x_min, LL[i].X()); x_max = max(x_max, UR[i].X());
+		y_min = min(y_min, LL[i].Y()); y_max = max(y_max, UR[i].Y());
+	}
+
+	// Grid of about one cell per polygon, with the polygons whose box touches each cell.
+	int cells = max(1, min(1024, int(ceil(sqrt(k)))));
+	auto cell = [&](double v, double v_min, double v_max) {
+		if (not (v_max > v_min)) return 0;
+		return max(0, min(cells - 1, int((v - v_min)/(v_max - v_min)*cells)));
+	};
+	vector<vector<int>> grid(cells*cells);
+	for (int i=0; i<k; ++i) {
+		if (empty[i]) continue;
+		for (int cy=cell(LL[i].Y(), y_min, y_max); cy<=cell(UR[i].Y(), y_min, y_max); ++cy) {
+			for (int cx=cell(LL[i].X(), x_min, x_max); cx<=cell(UR[i].X(), x_min, x_max); ++cx) {
+				grid[cy*cells + cx].push_back(i);
+			}
+		}
+	}
+
+	bool per_point = mode == "points";
+	// Small files are read without threads, as starting them would take longer.
+	int n_threads = max(size_t(1), min(size_t(max(1u, thread::hardware_concurrency())), file.length()/MIN_BYTES_PER_THREAD));
+
+	// With "join points", each thread streams its counts to a temporary file as they are found.
+	// They are copied in order to the output once the whole input has been read, as the output
+	// may be the input file itself.
+	vector<FILE*> parts;
+	if (per_point) {
+		for (int t=0; t<n_threads; ++t) parts.push_back(tmpfile());
+
+		// Error handling
+		if (count(parts.begin(), parts.end(), nullptr) > 0) {
+			for (FILE* part : parts) if (part != nullptr) fclose(part);
+			out << "error: cannot write file" << endl;
+			return;
+		}
+	}
+
+	// Each thread reads the lines that start in its part of the file.
+	vector<vector<long>> counts(n_threads, vector<long>(k, 0));
+	vector<char> failed(n_threads, false);	// Whether a thread could not write its counts
+	auto read_part = [&](int t) {
+		size_t pos = file.line_start(file.length()/n_threads*t);
+		size_t end = t == n_threads - 1 ? file.length() : file.line_start(file.length()/n_threads*(t+1));
+		const double eps = 1e-9;
+		string buffer;
+		Point p;
+		while (file.next(pos, end, p)) {
+			int inside = 0;
+			if (p.X() >= x_min - eps and p.X() <= x_max + eps and p.Y() >= y_min - eps and p.Y() <= y_max + eps) {
+				for (int i : grid[cell(p.Y(), y_min, y_max)*cells + cell(p.X(), x_min, x_max)]) {
+					if (p.X() < LL[i].X() - eps or p.X() > UR[i].X() + eps or p.Y() < LL[i].Y() - eps or p.Y() > UR[i].Y() + eps) continue;
+					if (cpols[i].p_is_inside(p)) {
+						++counts[t][i];
+						++inside;
+					}
+				}
+			}
+			if (per_point) {
+				buffer += to_string(inside);
+				buffer += '\n';
+				if (buffer.size() >= JOIN_BUFFER_SIZE) {
+					if (fwrite(buffer.data(), 1, buffer.size(), parts[t]) != buffer.size()) failed[t] = true;
+					buffer.clear();
+				}
+			}
+		}
+		if (per_point) {
+			if (fwrite(buffer.data(), 1, buffer.size(), parts[t]) != buffer.size()) failed[t] = true;
+			if (fflush(parts[t]) != 0 or ferror(parts[t])) failed[t] = true;
+		}
+	};
+	if (n_threads == 1) read_part(0);
+	else {
+		vector<thread> threads;
+		for (int t=0; t<n_threads; ++t) threads.push_back(thread(read_part, t));
+		for (thread& th : threads) th.join();
+	}
+
+	if (per_point) {
+		bool written = count(failed.begin(), failed.end(), true) == 0;
+		FILE* f = written ? fopen(output.c_str(), "w") : nullptr;
+		written = written and f != nullptr;
+		char block[1 << 16];
+		for (FILE* part : parts) {
+			rewind(part);	// It also clears the error flag, which the thread has already checked
+			size_t n;
+			while (written and (n = fread(block, 1, sizeof(block), part)) > 0) {
+				written = fwrite(block, 1, n, f) == n;
+			}
+			written = written and not ferror(part);
+			fclose(part);
+		}
+		if (f != nullptr) written = not ferror(f) and fclose(f) == 0 and written;
+
+		// Error handling
+		if (not written) {
+			out << "error: cannot write file" << endl;
+			return;
+		}
+
+		out << "ok" << endl;
+		return;
+	}
+	for (int i=0; i<k; ++i) {
+		long total = 0;
+		for (int t=0; t<n_threads; ++t) total += counts[t][i];
+		out << names[i] << ' ' << total << endl;
+	}
+}
+
+// Simplifies the polygon, removing vertices so that it moves at most the given tolerance.
+void simplify(map<string, Node>& polygons, istream& in, ostream& out) {
+	string s;
+	getline(in, s);
+	istringstream iss(s);
+	string name;
+	iss >> name;
+
+	// Error handling
+	if (polygons.count(name) == 0) {
+		out << "error: undefined polygon identifier" << endl;
+		return;
+	}
+
+	double tolerance;
+
+	// Error handling
+	if (!(iss >> tolerance) or tolerance < 0) {
+		out << "error: command with wrong number or type of arguments" << endl;
+		return;
+	}
+
+	ConvexPolygon polyg = evaluate(polygons.at(name));
+	polyg.simplify(tolerance);
+	polygons[name] = leaf(polyg);
+	out << "ok" << endl;
+}
+
+// Translates, scales or rotates a polygon. The transform is kept with the polygon and is only
+// applied to its vertices when they are printed or saved.
+void transform(const string& action, map<string, Node>& polygons, istream& in, ostream& out) {
+	string s;
+	getline(in, s);
+	istringstream iss(s);
+	string name;
+	iss >> name;
+
+	// Error handling
+	if (polygons.count(name) == 0) {
+		out << "error: undefined polygon identifier" << endl;
+		return;
+	}
+
+	vector<double> args;
+	double x;
+	while (iss.rdbuf()->in_avail()) { // Istringstream is not empty
+
+		// Error handling
+		if (!(iss >> x)) {
+			out << "error: command with wrong number or type of arguments" << endl;
+			return;
+		}
+		args.push_back(x);
+	}
+	int n = args.size();
+
+	// Error handling
+	bool valid = (action == "translate" and n == 2) or (action == "rotate" and n == 1)
+		or (action == "scale" and (n == 1 or n == 2));
+	if (not valid) {
+		out << "error: command with wrong number or type of arguments" << endl;
+		return;
+	}
+
+	// The node may be an operand of pending expressions, so it is replaced instead of modified.
+	ConvexPolygon polyg = evaluate(polygons.at(name));
+	if (action == "translate") polyg.translate(args[0], args[1]);
+	else if (action == "scale") polyg.scale(args[0], args[n-1]);
+	else polyg.rotate(args[0]);
+
+	// Error handling (a transform that collapses the polygon, even after several scalings,
+	// could not be undone to test points against it)
+	if (not polyg.invertible()) {
+		out << "error: command with wrong number or type of arguments" << endl;
+		return;
+	}
+	polygons[name] = leaf(polyg);
+	out << "ok" << endl;
+}
+
+// Prints the statistics of the cache of results. If a size (in bytes) is given, it
+// is set as the memory budget of the cache.
+void cache_stats(istream& in, ostream& out) {
+	string s;
+	getline(in, s);
+	istringstream iss(s);
+	if (iss.rdbuf()->in_avail()) {
+		long long budget;
+
+		// Error handling (a negative budget would wrap around as a size)
+		if (!(iss >> budget) or budget < 0) {
+			out << "error: command with wrong number or type of arguments" << endl;
+			return;
+		}
+
+		cache.set_budget(budget);
+	}
+	out << "hits " << cache.hits() << " misses " << cache.misses() << " hit_rate " << cache.hit_rate()
+		 << " memory " << cache.memory() << " budget " << cache.budget() << endl;
 }
 
 // Prints if the polygon is regular
-void regular(map<string, ConvexPolygon>& polygons) {
+void regular(map<string, Node>& polygons, istream& in, ostream& out) {
 	string s;
-	getline(cin, s);
+	getline(in, s);
 	istringstream iss(s);
 	string name;
 	iss >> name;
 
 	// Error handling
 	if (polygons.count(name) == 0) {
-		cout << "error: undefined polygon identifier" << endl;
+		out << "error: undefined polygon identifier" << endl;
 		return;
 	}
 
-	cout << (polygons[name].is_regular() ? "yes" : "no") << endl;
+	out << (evaluate(polygons.at(name)).is_regular() ? "yes" : "no") << endl;
 }
 
-int main() {
-	cout.setf(ios::fixed);
-    cout.precision(3);
-	map<string, ConvexPolygon> polygons;
+// Commands that change the polygons. The others only read them and can run at the same time.
+const set<string> WRITING_COMMANDS = {"polygon", "load", "restore", "setcol", "intersection", "union", "bbox", "simplify",
+									  "translate", "scale", "rotate"};
+
+// Lock of the polygons, shared by the commands that only read them. By default glibc lets
+// new readers in while a writer waits, so a steady flow of reading commands would keep the
+// writing ones waiting forever: writers are preferred instead. Such a lock must never be
+// taken twice by the same thread, which execute does not do.
+#ifdef PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP
+pthread_rwlock_t polygons_lock = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
+#else
+pthread_rwlock_t polygons_lock = PTHREAD_RWLOCK_INITIALIZER;
+#endif
+
+// Executes a command, reading its arguments from in and writing its output to out.
+void execute(const string& action, map<string, Node>& polygons, istream& in, ostream& out) {
+	if (WRITING_COMMANDS.count(action)) pthread_rwlock_wrlock(&polygons_lock);
+	else pthread_rwlock_rdlock(&polygons_lock);
+
+		 if (action == "#")			comment(in, out);
+	else if (action == "polygon")	polygon(polygons, in, out);
+	else if (action == "print")		print(polygons, in, out);
+	else if (action == "area")		area(polygons, in, out);
+	else if (action == "perimeter")	perimeter(polygons, in, out);
+	else if (action == "vertices")	n_vertices(polygons, in, out);
+	else if (action == "centroid")	centroid(polygons, in, out);
+	else if (action == "list")		::list(polygons, out);
+	else if (action == "metrics")	metrics(polygons, in, out);
+	else if (action == "save")		save(polygons, in, out);
+	else if (action == "load")		load(polygons, in, out);
+	else if (action == "snapshot")	snapshot(polygons, in, out);
+	else if (action == "restore")	restore(polygons, in, out);
+	else if (action == "setcol")	setcol(polygons, in, out);
+	else if (action == "draw")		draw(polygons, in, out);
+	else if (action == "intersection")	intersection(polygons, in, out);
+	else if (action == "union")		p_union(polygons, in, out);
+	else if (action == "inside")	inside(polygons, in, out);
+	else if (action == "distance")	distance_query(polygons, in, out, false);
+	else if (action == "nearest")	distance_query(polygons, in, out, true);
+	else if (action == "bbox") bbox(polygons, in, out);
+	else if (action == "regular") regular(polygons, in, out);
+	else if (action == "simplify")	simplify(polygons, in, out);
+	else if (action == "translate" or action == "scale" or action == "rotate") transform(action, polygons, in, out);
+	else if (action == "overlaps")	overlaps(polygons, in, out);
+	else if (action == "join")		join(polygons, in, out);
+	else if (action == "cache")		cache_stats(in, out);
+
+	// Error handling
+	else {
+		string s;
+		getline(in, s);
+		out << "error: unrecognized command" << endl;
+	}
+
+	pthread_rwlock_unlock(&polygons_lock);
+}
+
+// Most clients served at the same time. Further connections wait in the queue of the
+// socket until a client leaves.
+const int MAX_CLIENTS = 64;
+
+// Threads serving the clients, how many of them are still serving, and the ids of
+// those that finished and can be joined, with their lock and condition.
+map<thread::id, thread> clients;
+int n_clients = 0;
+vector<thread::id> finished;
+mutex clients_lock;
+condition_variable client_left;
+
+// Executes a command sent by a client and sends back its output.
+// Returns false if the output cannot be sent (the client left).
+bool reply(map<string, Node>& polygons, int fd, const string& line) {
+	istringstream in(line);
+	ostringstream out;
+	out.setf(ios::fixed);
+	out.precision(3);
 	string action;
-	while (cin >> action) {
-			 if (action == "#")			comment();
-		else if (action == "polygon")	polygon(polygons);
-		else if (action == "print")		print(polygons);
-		else if (action == "area")		area(polygons);
-		else if (action == "perimeter")	perimeter(polygons);
-		else if (action == "vertices")	n_vertices(polygons);
-		else if (action == "centroid")	centroid(polygons);
-		else if (action == "list")		list(polygons);
-		else if (action == "save")		save(polygons);
-		else if (action == "load")		load(polygons);
-		else if (action == "setcol")	setcol(polygons);
-		else if (action == "draw")		draw(polygons);
-		else if (action == "intersection")	intersection(polygons);
-		else if (action == "union")		p_union(polygons);
-		else if (action == "inside")	inside(polygons);
-		else if (action == "bbox") bbox(polygons);
-		else if (action == "regular") regular(polygons);
+	if (in >> action) execute(action, polygons, in, out);
+	string output = out.str();
+	for (size_t sent = 0; sent < output.size(); ) {
+		ssize_t w = write(fd, output.data() + sent, output.size() - sent);
+		if (w <= 0) return false;
+		sent += w;
+	}
+	return true;
+}
 
-		// Error handling
-		else {
-			string s;
-			getline(cin, s);
-			cout << "error: unrecognized command" << endl;
+// Serves a client connected to the socket: every line it sends is executed as a command
+// and the output is sent back.
+void serve_client(map<string, Node>& polygons, int fd) {
+	string buffer;
+	char chunk[4096];
+	ssize_t n;
+	bool connected = true;
+	while (connected and (n = read(fd, chunk, sizeof(chunk))) > 0) {
+		buffer.append(chunk, n);
+		size_t start = 0, end;
+		while (connected and (end = buffer.find('\n', start)) != string::npos) {
+			connected = reply(polygons, fd, buffer.substr(start, end - start));
+			start = end + 1;
+		}
+		buffer.erase(0, start);
+	}
+
+	// The last command may not end with a newline.
+	if (connected and n == 0 and not buffer.empty()) reply(polygons, fd, buffer);
+	close(fd);
+
+	lock_guard<mutex> guard(clients_lock);
+	--n_clients;
+	finished.push_back(this_thread::get_id());
+	client_left.notify_one();
+}
+
+// Joins the threads of the clients that left.
+void join_finished() {
+	vector<thread> done;
+	{
+		lock_guard<mutex> guard(clients_lock);
+		for (thread::id id : finished) {
+			done.push_back(move(clients[id]));
+			clients.erase(id);
 		}
+		finished.clear();
 	}
+	for (thread& t : done) t.join();
+}
+
+// Tells whether path is a socket that no server is listening on (such as the one
+// left by a server that was stopped).
+bool stale_socket(const char* path, const sockaddr_un& addr) {
+	struct stat st;
+	if (lstat(path, &st) != 0 or not S_ISSOCK(st.st_mode)) return false;
+	int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (probe < 0) return false;
+	bool stale = connect(probe, (const sockaddr*) &addr, sizeof(addr)) < 0 and errno == ECONNREFUSED;
+	close(probe);
+	return stale;
+}
+
+// Listens on a Unix domain socket and serves every client in its own thread (up to
+// MAX_CLIENTS at the same time), all of them sharing the same polygons. An existing
+// file is only replaced if it is a stale socket. If the socket fails, it stops accepting
+// clients and returns when the ones being served have left.
+int serve(map<string, Node>& polygons, const char* path) {
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	if (stale_socket(path, addr)) unlink(path);
+	if (server < 0 or bind(server, (sockaddr*) &addr, sizeof(addr)) < 0 or listen(server, SOMAXCONN) < 0) {
+		cerr << "error: cannot listen on " << path << endl;
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN); // Clients that leave must not stop the server
+	int status = 0;
+	while (status == 0) {
+		join_finished();
+		{
+			unique_lock<mutex> guard(clients_lock);
+			client_left.wait(guard, []() { return n_clients < MAX_CLIENTS; });
+		}
+		int client = accept(server, nullptr, nullptr);
+		if (client >= 0) {
+			lock_guard<mutex> guard(clients_lock);
+			++n_clients;
+			thread t(serve_client, ref(polygons), client);
+			clients[t.get_id()] = move(t);
+		}
+		// Out of descriptors or memory: the connection stays queued until some is freed.
+		else if (errno == EMFILE or errno == ENFILE or errno == ENOBUFS or errno == ENOMEM) {
+			this_thread::sleep_for(chrono::milliseconds(100));
+		}
+		// An interrupted call or a client that left before being accepted is not an error.
+		else if (errno != EINTR and errno != ECONNABORTED and errno != EPROTO) {
+			cerr << "error: cannot accept clients on " << path << endl;
+			status = 1;
+		}
+	}
+	close(server);
+
+	// The clients share the polygons, so they must all leave before they are destroyed.
+	for (auto& c : clients) c.second.join();
+	return status;
+}
+
+// Reads the commands from the standard input or, with --server <socket>, from the
+// clients connected to a Unix domain socket.
+int main(int argc, char* argv[]) {
+	map<string, Node> polygons;
+	if (argc == 3 and string(argv[1]) == "--server") return serve(polygons, argv[2]);
+
+	cout.setf(ios::fixed);
+    cout.precision(3);
+	string action;
+	while (cin >> action) execute(action, polygons, cin, cout);
 }
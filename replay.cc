@@ -0,0 +1,176 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+/*	Replays a command script (such as the ones written by gen) through the polygon
+ *	calculator and reports its throughput, the latency of each kind of command and the
+ *	peak memory of the calculator.
+ *
+ *	Usage: replay [-t seconds] script [calculator]	(the calculator is ./polygon_calculator by default)
+ *
+ *	Every command is followed by an empty line and a comment, whose output ("#") marks the end
+ *	of the output of the command, so each command is timed from when it is sent until all its
+ *	output has been read. Comments in the script are not sent. Some commands read one more
+ *	line when they fail (such as union with an undefined polygon): they take the empty line,
+ *	which is ignored otherwise, so the comment is still seen. If the end of the output of a
+ *	command does not arrive in the given time (10 seconds by default), the replay stops.
+ */
+
+typedef chrono::steady_clock Clock;
+
+// Returns the value below which there are a fraction q of the sorted values.
+double percentile(const vector<double>& sorted, double q) {
+	if (sorted.empty()) return 0;
+	int i = min(int(sorted.size()) - 1, int(q*sorted.size()));
+	return sorted[i];
+}
+
+// Reads a line of the output of the calculator (without the newline), keeping what is read after
+// it in pending. Returns 1 if a line was read, 0 if the calculator stopped and -1 if no line
+// arrived in timeout seconds.
+int read_line(int fd, string& pending, string& line, double timeout) {
+	Clock::time_point limit = Clock::now() + chrono::duration_cast<Clock::duration>(chrono::duration<double>(timeout));
+	size_t newline;
+	while ((newline = pending.find('\n')) == string::npos) {
+		int ms = chrono::duration_cast<chrono::milliseconds>(limit - Clock::now()).count();
+		struct pollfd pfd = {fd, POLLIN, 0};
+		if (ms <= 0 or poll(&pfd, 1, ms) == 0) return -1;
+		char buffer[4096];
+		ssize_t n = read(fd, buffer, sizeof(buffer));
+		if (n < 0 and errno == EINTR) continue;
+		if (n <= 0) return 0;
+		pending.append(buffer, n);
+	}
+	line = pending.substr(0, newline);
+	pending.erase(0, newline + 1);
+	return 1;
+}
+
+// Prints the number of commands and the latency percentiles (in microseconds) of a kind of command.
+void report(const string& kind, vector<double>& latencies) {
+	sort(latencies.begin(), latencies.end());
+	double total = 0;
+	for (double l : latencies) total += l;
+	printf("%-14s %10zu %10.1f %10.1f %10.1f %10.1f %10.1f\n", kind.c_str(), latencies.size(),
+		   total/latencies.size(), percentile(latencies, 0.5), percentile(latencies, 0.9),
+		   percentile(latencies, 0.99), latencies.back());
+}
+
+int main(int argc, char* argv[]) {
+	double timeout = 10;
+	vector<const char*> files;
+	bool valid = true;
+	for (int i=1; i<argc; ++i) {
+		if (strcmp(argv[i], "-t") == 0) {
+			valid = valid and i + 1 < argc;
+			if (valid) timeout = atof(argv[++i]);
+		}
+		else files.push_back(argv[i]);
+	}
+	if (not valid or timeout <= 0 or files.size() < 1 or files.size() > 2) {
+		cerr << "usage: replay [-t seconds] script [calculator]" << endl;
+		return 1;
+	}
+	const char* calculator = files.size() == 2 ? files[1] : "./polygon_calculator";
+	ifstream script(files[0]);
+	if (not script) {
+		cerr << "error: cannot read " << files[0] << endl;
+		return 1;
+	}
+
+	// Starting the calculator with pipes to its input and output. If it stops, writing
+	// to it must not stop the replay, so that what was measured is still reported.
+	signal(SIGPIPE, SIG_IGN);
+	int to_child[2], from_child[2];
+	if (pipe(to_child) != 0 or pipe(from_child) != 0) {
+		perror("pipe");
+		return 1;
+	}
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return 1;
+	}
+	if (pid == 0) {
+		dup2(to_child[0], 0);
+		dup2(from_child[1], 1);
+		close(to_child[0]); close(to_child[1]);
+		close(from_child[0]); close(from_child[1]);
+		execl(calculator, calculator, (char*) nullptr);
+		perror(calculator);
+		_exit(127);
+	}
+	close(to_child[0]);
+	close(from_child[1]);
+	FILE* in = fdopen(to_child[1], "w");
+	int out = from_child[0];
+
+	map<string, vector<double>> latencies;
+	vector<double> all;
+	long errors = 0;
+	bool alive = true, answered = true;
+	string line, output, pending;
+	Clock::time_point start = Clock::now();
+	while (alive and answered and getline(script, line)) {
+		string kind;
+		istringstream(line) >> kind;
+		if (kind.empty() or kind[0] == '#') continue;
+
+		Clock::time_point sent = Clock::now();
+		fprintf(in, "%s\n\n#\n", line.c_str());
+		fflush(in);
+		while (true) {
+			int result = read_line(out, pending, output, timeout);
+			alive = result != 0;
+			answered = result != -1;
+			if (result != 1) break;
+			if (output == "#") break;
+			if (output.compare(0, 5, "error") == 0) ++errors;
+		}
+		if (not answered) {
+			cerr << "error: no answer to \"" << line << "\" in " << timeout << " seconds" << endl;
+			kill(pid, SIGKILL);
+			break;
+		}
+		if (not alive) break;
+		double us = chrono::duration<double, micro>(Clock::now() - sent).count();
+		latencies[kind].push_back(us);
+		all.push_back(us);
+	}
+	double seconds = chrono::duration<double>(Clock::now() - start).count();
+	fclose(in);
+	char buffer[4096];
+	while (read(out, buffer, sizeof(buffer)) > 0) {}
+	close(out);
+
+	int status;
+	struct rusage usage;
+	wait4(pid, &status, 0, &usage);
+	if (not alive) cerr << "error: the calculator stopped before the end of the script" << endl;
+
+	printf("commands       %10zu\n", all.size());
+	printf("errors         %10ld\n", errors);
+	printf("seconds        %10.3f\n", seconds);
+	printf("commands/sec   %10.1f\n", all.size()/seconds);
+	printf("peak RSS (KB)  %10ld\n", usage.ru_maxrss);
+	printf("\n%-14s %10s %10s %10s %10s %10s %10s\n", "latency (us)", "count", "mean", "p50", "p90", "p99", "max");
+	for (auto& elem : latencies) report(elem.first, elem.second);
+	if (not all.empty()) report("all", all);
+	return alive and answered and WIFEXITED(status) and WEXITSTATUS(status) == 0 ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Runs the test cases from the root of the repository and compares their outputs with the
+# expected ones. Files written by a test case in its folder are compared too: for each
+# exptd_<name> other than exptd_output, the file <name> must have the same contents.
+#
+# Usage: ./test_cases/run_tests.sh [calculator]     (./polygon_calculator by default)
+
+calculator=${1:-./polygon_calculator}
+failed=0
+for dir in test_cases/test_case_*/; do
+	$calculator < $dir/input > $dir/output 2>&1
+	for expected in $dir/exptd_*; do
+		name=$(basename $expected | sed 's/^exptd_//')
+		if ! cmp -s $expected $dir/$name; then
+			echo "FAIL $dir$name"
+			failed=1
+		fi
+	done
+done
+[ $failed = 0 ] && echo "All test cases passed"
+exit $failed